@@ -0,0 +1,138 @@
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+
+using namespace std;
+
+/*
+Checks MIDI_File construction from a caller-supplied memory resource: every file
+given on the command line is decoded into a file on a monotonic buffer, with
+`decode`, `decode_byte` and (on a synchronized pool) `decode_parallel`. The
+result must re-encode to the same bytes as a file decoded the usual way. While
+decoding into the buffer the default resource is the null resource, so any
+allocation that does not come from the file's own resource fails.
+
+Each file is then decoded twice more with the same decoder into the same
+`MIDI_File`, cleared in between. The second time the file must not allocate at
+all.
+*/
+
+class Counting_Resource : public pmr::memory_resource
+{
+public:
+  size_t allocations{0};
+
+protected:
+  void* do_allocate(size_t bytes, size_t alignment)
+  {
+    ++allocations;
+    return pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t alignment)
+  {
+    pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const pmr::memory_resource& other) const noexcept
+  {
+    return this == &other;
+  }
+};
+
+static Counting_Resource reuse_resource{};
+static MIDI_File reused(&reuse_resource);
+static MIDI_File_Decoder reused_dec{};
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File expected{};
+  vector<uint8_t> expected_bytes{};
+
+  bool decode_ok = decode_file(data, size, expected);
+  bool match = !decode_ok || encode_file(expected, expected_bytes);
+
+  for (int method = 0; match && (method < 3); ++method)
+  {
+    pmr::monotonic_buffer_resource buffer{};
+    pmr::synchronized_pool_resource pool{};
+    pmr::memory_resource* resource = (method == 2) ? (pmr::memory_resource*)&pool : (pmr::memory_resource*)&buffer;
+    MIDI_File_Decoder arena_dec{};
+    MIDI_Element_Decoder::STATUS result = MIDI_Element_Decoder::STATUS::FAIL;
+    pmr::memory_resource* previous = pmr::set_default_resource(pmr::null_memory_resource());
+    MIDI_File decoded(resource);
+
+    try
+    {
+      switch (method)
+      {
+        case 0:
+        {
+          result = arena_dec.decode(data, size, decoded);
+          break;
+        }
+        case 1:
+        {
+          // bytes after the last chunk are not part of the file
+          result = MIDI_Element_Decoder::STATUS::STANDBY;
+
+          for (size_t i = 0; (i < size) && (result == MIDI_Element_Decoder::STATUS::STANDBY); ++i)
+          {
+            result = arena_dec.decode_byte(data[i], &decoded);
+          }
+          break;
+        }
+        default:
+        {
+          result = arena_dec.decode_parallel(data, size, decoded, 4);
+          break;
+        }
+      }
+    }
+    catch (const bad_alloc&)
+    {
+      match = false;
+    }
+
+    pmr::set_default_resource(previous);
+
+    if ((method == 1) && !decode_ok)
+    {
+      continue; // decode_byte reports STANDBY rather than FAIL for truncated input
+    }
+
+    match = match && ((result == MIDI_Element_Decoder::STATUS::SUCCESS) == decode_ok);
+
+    if (match && decode_ok)
+    {
+      vector<uint8_t> decoded_bytes{};
+      match = encode_file(decoded, decoded_bytes) && (decoded_bytes == expected_bytes);
+    }
+  }
+
+  for (int pass = 0; match && (pass < 2); ++pass)
+  {
+    size_t before = reuse_resource.allocations;
+    vector<uint8_t> decoded_bytes{};
+
+    reused.clear();
+    reused_dec.clear();
+
+    bool reused_ok = (reused_dec.decode(data, size, reused) == MIDI_Element_Decoder::STATUS::SUCCESS);
+
+    match = (reused_ok == decode_ok) && (!decode_ok || (encode_file(reused, decoded_bytes) && (decoded_bytes == expected_bytes)));
+    match = match && ((pass == 0) || (reuse_resource.allocations == before));
+  }
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file);
+}
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_Encoder.h"
+
+using namespace std;
+
+/*
+Throughput benchmark over a synthetic corpus. Every corpus file is generated
+from fixed formulas, so each run (and each build of the library) sees the same
+bytes:
+
+    dense_notes      one track of notes hopping between channels, so running
+                     status never applies
+    running_status   one track of notes and controllers on a single channel,
+                     nearly every event under running status
+    long_sysex       one track of 4 KiB sysex messages
+    many_tracks      512 short tracks
+    large_unkn       a short track between unknown chunks of 1 MiB each
+    extended_mthd    an MThd chunk with 64 KiB of extended content and a short
+                     track
+
+Each file is decoded with `MIDI_File_Decoder::decode` into a cleared, reused
+`MIDI_File` (the pattern recommended for processing many files), encoded with
+`MIDI_File_Encoder::encode_to` into a reused buffer, and decoded and encoded
+again as a round trip. Every operation is timed `repeats` times and reported
+as MB/s of file bytes and millions of events per second at the 50th, 90th and
+99th percentile of the run times (higher percentiles are the slower runs).
+
+Usage: bench [repeats [directory]]. With a directory the corpus is also written
+there as .mid files.
+*/
+
+static const int     default_repeats = 31;
+
+struct Corpus_File
+{
+  string               name{};
+  vector<uint8_t>      bytes{};
+  size_t               events{0};
+};
+
+static void end_track(MTrk_Chunk& track)
+{
+  MTrk_Event& end_of_track = track.emplace_back_event();
+  end_of_track.push_byte(STATUS_BYTE::META);
+  end_of_track.push_byte(0x2F);
+  end_of_track.push_byte(0x00);
+}
+
+static void push_notes(MTrk_Chunk& track, size_t count, bool hop_channels)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    MTrk_Event& event = track.emplace_back_event();
+    uint8_t channel = hop_channels ? (uint8_t)(i % 16) : 0;
+    uint8_t key = (uint8_t)((i * 7) % 128);
+
+    event.set_dt((uint32_t)((i % 3) ? 0 : (i % 200)));
+
+    if (!hop_channels && ((i % 32) == 31))
+    {
+      event.push_byte(0xB0); // control change, breaks the run of notes
+      event.push_byte(0x07);
+      event.push_byte((uint8_t)(i % 128));
+    }
+    else
+    {
+      event.push_byte((uint8_t)((((i / 2) % 2) ? 0x80 : 0x90) | channel));
+      event.push_byte(key);
+      event.push_byte(hop_channels ? (uint8_t)(i % 128) : 0x40);
+    }
+  }
+}
+
+static void push_sysex(MTrk_Chunk& track, size_t count, size_t size)
+{
+  vector<uint8_t> payload(size);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    payload[0] = STATUS_BYTE::SYSEX_F0;
+
+    for (size_t b = 1; b < (size - 1); ++b)
+    {
+      payload[b] = (uint8_t)((b * 31 + i) % 128);
+    }
+
+    payload[size - 1] = 0xF7;
+
+    MTrk_Event& event = track.emplace_back_event();
+    event.set_dt((uint32_t)(i % 100));
+    event.push_bytes(payload.data(), payload.size());
+  }
+}
+
+static void set_header(MIDI_File& file, uint16_t fmt, uint16_t ntrks)
+{
+  file.get_hdr().set_len(6 + (uint32_t)file.get_hdr().get_extended_size());
+  file.get_hdr().set_fmt(fmt);
+  file.get_hdr().set_ntrks(ntrks);
+  file.get_hdr().set_div(480);
+}
+
+static void build_file(const string& name, MIDI_File& file)
+{
+  if (name == "dense_notes")
+  {
+    MTrk_Chunk& track = file.emplace_back_mtrk();
+    push_notes(track, 1000000, true);
+    end_track(track);
+    set_header(file, 0, 1);
+  }
+  else if (name == "running_status")
+  {
+    MTrk_Chunk& track = file.emplace_back_mtrk();
+    push_notes(track, 1000000, false);
+    end_track(track);
+    set_header(file, 0, 1);
+  }
+  else if (name == "long_sysex")
+  {
+    MTrk_Chunk& track = file.emplace_back_mtrk();
+    push_sysex(track, 1024, 4096);
+    end_track(track);
+    set_header(file, 0, 1);
+  }
+  else if (name == "many_tracks")
+  {
+    for (size_t t = 0; t < 512; ++t)
+    {
+      MTrk_Chunk& track = file.emplace_back_mtrk();
+      push_notes(track, 2000, (t % 2) == 0);
+      end_track(track);
+    }
+
+    set_header(file, 1, 512);
+  }
+  else if (name == "large_unkn")
+  {
+    vector<uint8_t> bytes(1 << 20);
+
+    for (size_t t = 0; t < 4; ++t)
+    {
+      for (size_t b = 0; b < bytes.size(); ++b)
+      {
+        bytes[b] = (uint8_t)(b * 131 + t);
+      }
+
+      UNkn_Chunk& unkn = file.emplace_back_unkn();
+      unkn.set_header(0x58465F30 + (uint32_t)t); // "XF_0".."XF_3"
+      unkn.set_len((uint32_t)bytes.size());
+      unkn.push_bytes(bytes.data(), bytes.size());
+
+      if (t == 1)
+      {
+        MTrk_Chunk& track = file.emplace_back_mtrk();
+        push_notes(track, 1000, true);
+        end_track(track);
+      }
+    }
+
+    set_header(file, 0, 5);
+  }
+  else if (name == "extended_mthd")
+  {
+    for (size_t b = 0; b < (1 << 16); ++b)
+    {
+      file.get_hdr().push_byte((uint8_t)(b * 17));
+    }
+
+    MTrk_Chunk& track = file.emplace_back_mtrk();
+    push_notes(track, 1000, true);
+    end_track(track);
+    set_header(file, 0, 1);
+  }
+}
+
+static size_t count_events(MIDI_File& file)
+{
+  size_t events = 0;
+
+  for (size_t i = 0; i < file.get_hdr().get_ntrks(); ++i)
+  {
+    if (file.get_chunk(i).get_header() == CHUNK_HEADER::MTRK)
+    {
+      events += static_cast<MTrk_Chunk&>(file.get_chunk(i)).size();
+    }
+  }
+
+  return events;
+}
+
+template <class F>
+static vector<double> time_runs(int repeats, F run)
+{
+  vector<double> seconds{};
+
+  for (int r = 0; r < repeats; ++r)
+  {
+    auto start = chrono::steady_clock::now();
+    run();
+    seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  }
+
+  sort(seconds.begin(), seconds.end());
+  return seconds;
+}
+
+static double percentile(const vector<double>& sorted, double p)
+{
+  size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+
+  return sorted[index];
+}
+
+static void report(const Corpus_File& corpus_file, const char* operation, const vector<double>& seconds)
+{
+  static const double percentiles[] = {0.50, 0.90, 0.99};
+
+  cout << left << setw(16) << corpus_file.name << setw(12) << operation << right << fixed << setprecision(1);
+
+  for (double p : percentiles)
+  {
+    cout << setw(10) << ((double)corpus_file.bytes.size() / percentile(seconds, p) / 1e6);
+  }
+
+  for (double p : percentiles)
+  {
+    cout << setw(10) << ((double)corpus_file.events / percentile(seconds, p) / 1e6);
+  }
+
+  cout << endl;
+}
+
+int main(int argc, char **argv)
+{
+  static const char* names[] = {"dense_notes", "running_status", "long_sysex", "many_tracks", "large_unkn", "extended_mthd"};
+
+  int repeats = (argc > 1) ? atoi(argv[1]) : default_repeats;
+  bool ok = (repeats > 0);
+  vector<Corpus_File> corpus{};
+
+  /****************************************
+  Generate the corpus
+  ****************************************/
+  for (const char* name : names)
+  {
+    MIDI_File file{};
+    MIDI_File_Encoder enc{};
+    Corpus_File corpus_file{};
+
+    build_file(name, file);
+    enc.set_data(&file);
+
+    corpus_file.name = name;
+    corpus_file.events = count_events(file);
+    ok = ok && (enc.encode_to(corpus_file.bytes) == MIDI_Element_Encoder::STATUS::SUCCESS);
+
+    if (argc > 2)
+    {
+      ofstream file_writer(string(argv[2]) + "/" + name + ".mid", ios::out | ios::binary);
+      file_writer.write((const char*)corpus_file.bytes.data(), corpus_file.bytes.size());
+      ok = ok && file_writer.good();
+    }
+
+    corpus.push_back(std::move(corpus_file));
+  }
+
+  /****************************************
+  Time decode, encode and round trip
+  ****************************************/
+  MIDI_File decoded{};
+  MIDI_File_Decoder dec{};
+  MIDI_File_Encoder enc{};
+  vector<uint8_t> encoded{};
+  vector<vector<double>> results{};
+
+  for (Corpus_File& corpus_file : corpus)
+  {
+    auto decode = [&]()
+    {
+      decoded.clear();
+      dec.clear();
+      ok = ok && (dec.decode(corpus_file.bytes.data(), corpus_file.bytes.size(), decoded) == MIDI_Element_Decoder::STATUS::SUCCESS);
+    };
+
+    auto encode = [&]()
+    {
+      enc.set_data(&decoded);
+      ok = ok && (enc.encode_to(encoded) == MIDI_Element_Encoder::STATUS::SUCCESS);
+    };
+
+    if (!ok)
+    {
+      break;
+    }
+
+    decode();
+    encode();
+    ok = ok && (encoded == corpus_file.bytes) && (count_events(decoded) == corpus_file.events);
+
+    results.push_back(time_runs(repeats, decode));
+    results.push_back(time_runs(repeats, encode));
+    results.push_back(time_runs(repeats, [&](){ decode(); encode(); }));
+  }
+
+  cout << (ok ? "complete" : "fail") << endl;
+
+  if (!ok)
+  {
+    return 1;
+  }
+
+  cout << "runs: " << repeats << endl;
+  cout << left << setw(16) << "file" << setw(12) << "operation" << right
+       << setw(10) << "MB/s p50" << setw(10) << "p90" << setw(10) << "p99"
+       << setw(10) << "Mev/s p50" << setw(10) << "p90" << setw(10) << "p99" << endl;
+
+  for (size_t i = 0; i < corpus.size(); ++i)
+  {
+    report(corpus[i], "decode", results[3 * i]);
+    report(corpus[i], "encode", results[3 * i + 1]);
+    report(corpus[i], "round_trip", results[3 * i + 2]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include <cstdint>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_View.h"
+
+using namespace std;
+
+/*
+Checks the channel message getters and `Channel_Event`. Every track of every
+file given on the command line is decoded into an `MTrk_Chunk` and, with the
+`std::vector<Channel_Event>` overload of `MTrk_Chunk_Decoder::decode`, into
+packed channel events. Both decodes must succeed or fail together, and the
+packed events must match the ticks, status and data bytes read back through
+the getters of `MTrk_Event` and `MTrk_Event_View`, which in turn must match
+the raw payload bytes.
+*/
+
+static bool same_event(const Channel_Event& a, const Channel_Event& b)
+{
+  return (a.tick == b.tick) && (a.status == b.status) && (a.data1 == b.data1) && (a.data2 == b.data2) &&
+         (a.reserved == 0) && (a.get_channel() == b.get_channel()) && (a.get_pitch_bend() == b.get_pitch_bend());
+}
+
+static bool check_getters(MTrk_Event& event)
+{
+  uint32_t size = event.get_payload_size();
+  uint8_t data1 = (size > 1) ? event[1] : 0;
+  uint8_t data2 = (size > 2) ? event[2] : 0;
+
+  return (event.get_command() == (event[0] & 0xF0)) && (event.get_channel() == (event[0] & 0x0F)) &&
+         (event.get_data1() == data1) && (event.get_data2() == data2) &&
+         (event.get_pitch_bend() == (data1 | (data2 << 7)));
+}
+
+static bool compare_track(MTrk_View& view)
+{
+  MTrk_Chunk_Decoder chunk_dec{};
+  MTrk_Chunk_Decoder channel_dec{};
+  MTrk_Chunk track{};
+  vector<Channel_Event> packed{};
+  vector<Channel_Event> expected{};
+
+  MIDI_Element_Decoder::STATUS status = chunk_dec.decode(view.get_body(), view.get_len(), track);
+
+  if (channel_dec.decode(view.get_body(), view.get_len(), packed) != status)
+  {
+    return false;
+  }
+
+  if (status != MIDI_Element_Decoder::STATUS::SUCCESS)
+  {
+    return true; // nothing to compare
+  }
+
+  /****************************************
+  Channel events of the decoded track
+  ****************************************/
+  uint32_t tick = 0;
+
+  for (MTrk_Event& event : track)
+  {
+    tick += event.get_dt();
+
+    if (event.get_status_class() != STATUS_CLASS::CHANNEL)
+    {
+      continue;
+    }
+
+    if (!check_getters(event))
+    {
+      return false;
+    }
+
+    expected.push_back({tick, event.get_status(), event.get_data1(), event.get_data2(), 0});
+  }
+
+  if (packed.size() != expected.size())
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < packed.size(); ++i)
+  {
+    if (!same_event(packed[i], expected[i]))
+    {
+      return false;
+    }
+  }
+
+  /****************************************
+  The views read the same bytes
+  ****************************************/
+  size_t next = 0;
+
+  for (MTrk_Event_View& event : view)
+  {
+    if (event.get_status_class() != STATUS_CLASS::CHANNEL)
+    {
+      continue;
+    }
+
+    if ((next == packed.size()) || (event.get_status() != packed[next].status) ||
+        (event.get_command() != packed[next].get_command()) || (event.get_channel() != packed[next].get_channel()) ||
+        (event.get_data1() != packed[next].data1) || (event.get_data2() != packed[next].data2) ||
+        (event.get_pitch_bend() != packed[next].get_pitch_bend()))
+    {
+      return false;
+    }
+
+    ++next;
+  }
+
+  return (next == packed.size());
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File_View file{};
+
+  if (file.index(data, size) != MIDI_Element_Decoder::STATUS::SUCCESS)
+  {
+    return true; // nothing to compare
+  }
+
+  bool match = true;
+
+  for (size_t i = 0; match && (i < file.get_MTrk_count()); ++i)
+  {
+    match = compare_track(file.get_MTrk(i));
+  }
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file);
+}
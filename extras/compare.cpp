@@ -0,0 +1,116 @@
+#include <iostream>
+#include <string>
+
+#include "compare.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_Encoder.h"
+#include "MIDI_Loader.h"
+
+using namespace std;
+
+bool decode_file(const uint8_t* data, size_t size, MIDI_File& file)
+{
+  MIDI_File_Decoder dec{};
+
+  return (dec.decode(data, size, file) == MIDI_Element_Decoder::STATUS::SUCCESS);
+}
+
+bool encode_file(MIDI_File& file, vector<uint8_t>& encoded)
+{
+  MIDI_File_Encoder enc{};
+  enc.set_data(&file);
+
+  return (enc.encode_to(encoded) == MIDI_Element_Encoder::STATUS::SUCCESS);
+}
+
+bool same_bytes(MIDI_File& file, const vector<uint8_t>& expected)
+{
+  vector<uint8_t> encoded{};
+
+  return encode_file(file, encoded) && (encoded == expected);
+}
+
+void damage(const vector<uint8_t>& bytes, vector<vector<uint8_t>>& copies)
+{
+  static const uint8_t values[] = {0x00, 0x7F, 0x80, 0xF0, 0xF7, 0xFF};
+  size_t size = bytes.size();
+
+  copies.clear();
+
+  // cut short in the headers and through the tracks
+  for (size_t k = 1; k < 8; ++k)
+  {
+    copies.emplace_back(bytes.begin(), bytes.begin() + (size * k / 8));
+  }
+
+  if (size > 0)
+  {
+    copies.emplace_back(bytes.begin(), bytes.end() - 1);
+  }
+
+  // every byte of the MThd chunk, of the chunk header after it and of the first events, then 16 more through the tracks
+  for (size_t pos = 0; pos < size; pos += (pos < 32) ? 1 : (size / 16 + 1))
+  {
+    for (uint8_t value : values)
+    {
+      if (bytes[pos] != value)
+      {
+        copies.emplace_back(bytes);
+        copies.back()[pos] = value;
+      }
+    }
+  }
+}
+
+int run_compare(int argc, char** argv, Compare_Function compare, initializer_list<Compare_Check> checks)
+{
+  bool all_match = true;
+  vector<string> lines{};
+  vector<vector<uint8_t>> copies{};
+
+  for (int i = 1; i < argc; ++i)
+  {
+    MIDI_File_Loader loader{};
+    vector<string> damaged{};
+    bool match = loader.open(argv[i]);
+
+    if (match)
+    {
+      // copied, so that reading past the end of the file is reading past the end of an allocation
+      vector<uint8_t> bytes(loader.get_data(), loader.get_data() + loader.get_size());
+
+      match = compare(bytes.data(), bytes.size());
+      damage(bytes, copies);
+
+      for (size_t n = 0; n < copies.size(); ++n)
+      {
+        if (!compare(copies[n].data(), copies[n].size()))
+        {
+          damaged.push_back(string(argv[i]) + " copy " + to_string(n) + " mismatch");
+          match = false;
+        }
+      }
+    }
+
+    lines.push_back(string(argv[i]) + (match ? " match" : " mismatch"));
+    lines.insert(lines.end(), damaged.begin(), damaged.end());
+    all_match = all_match && match;
+  }
+
+  for (const Compare_Check& check : checks)
+  {
+    bool match = check.check();
+
+    lines.push_back(string(check.name) + (match ? " match" : " mismatch"));
+    all_match = all_match && match;
+  }
+
+  cout << (all_match ? "complete" : "fail") << endl;
+
+  for (const string& line : lines)
+  {
+    cout << line << endl;
+  }
+
+  return all_match ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "MIDI_Data.h"
+
+/*
+Shared driver of the `*_compare` programs. `run_compare` loads every file given
+on the command line and hands its bytes to the program's compare function, then
+does the same for damaged copies of the file: truncated at several points, and
+with single bytes replaced by values the decoders treat specially (0x00, 0x7F,
+0x80, 0xF0, 0xF7 and 0xFF). Each compare function must hold for all of them,
+which usually means every decoder under test rejects the same copies. Checks
+that do not depend on a file run after the files.
+
+The first line printed is "complete" when everything matched and "fail"
+otherwise, followed by one line per file and one per check. A damaged copy that
+does not match is reported on a line of its own.
+*/
+
+typedef bool (*Compare_Function)(const uint8_t* data, size_t size);
+
+struct Compare_Check
+{
+  const char*          name{nullptr};
+  bool                 (*check)(){nullptr};
+};
+
+bool decode_file(const uint8_t* data, size_t size, MIDI_File& file);
+bool encode_file(MIDI_File& file, std::vector<uint8_t>& encoded);
+bool same_bytes(MIDI_File& file, const std::vector<uint8_t>& expected);
+
+void damage(const std::vector<uint8_t>& bytes, std::vector<std::vector<uint8_t>>& copies);
+
+int run_compare(int argc, char** argv, Compare_Function compare, std::initializer_list<Compare_Check> checks = {});
+
+#endif
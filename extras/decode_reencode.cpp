@@ -1,12 +1,12 @@
 #include <cstdint>
 #include <fstream>
 #include <iostream>
-#include <iterator>
 #include <vector>
 
 #include "MIDI_Data.h"
 #include "MIDI_Decoder.h"
 #include "MIDI_Encoder.h"
+#include "MIDI_Loader.h"
 
 using namespace std;
 
@@ -20,59 +20,44 @@ int main(int argc, char **argv)
   char const* file_in  = argv[1];
   char const* file_out = argv[2];
 
-  uint8_t curr_byte{};
-  MIDI_File_Decoder dec{};
+  MIDI_File_Loader loader{};
   MIDI_File decoded{};
   MIDI_File_Encoder enc{};
   vector<uint8_t> encoded{};
 
-  streampos size{};
-  std::vector<uint8_t> midi_contents{};
   ofstream file_writer{};
-  ifstream file_reader (file_in, ios::in|ios::binary|ios::ate);
   
   /****************************************
-  Read the input .mid file
+  Map (or read) the input .mid file
   *****************************************/
-  if (file_reader.is_open())
-  {
-    size = file_reader.tellg();
-    midi_contents.resize(size);
-    file_reader.seekg(0, ios::beg);
-    file_reader.read((char*)midi_contents.data(), size);
-    file_reader.close();
-  }
-  else
+  if (!loader.open(file_in))
   {
     cout << "file_failed_to_open_.mid_file " << endl;
     return 1;
   }
 
+  const uint8_t* midi_contents = loader.get_data();
+  size_t size = loader.get_size();
+
   /****************************************
   Deserialize the .mid data
   ****************************************/
-  for (int i = 0; i < size; ++i)
-  {
-    curr_byte = (uint8_t)(midi_contents[i]);
-    
-    MIDI_Element_Decoder::STATUS parse_status = dec.decode_byte(curr_byte, &decoded);
-    while ((parse_status != MIDI_Element_Decoder::STATUS::STANDBY) && (parse_status != MIDI_Element_Decoder::STATUS::FAIL))
-    {
-        parse_status = dec.decode_byte(curr_byte, &decoded);
-    }
-  }
+  MIDI_File_Decoder dec{};
+  dec.decode_parallel(midi_contents, size, decoded);
   
   /****************************************
   Serialize the MIDI file object
   ****************************************/
   enc.set_data(&decoded);
+  enc.encode_parallel(encoded);
   
-  while(enc.encode_byte(curr_byte) != MIDI_Element_Encoder::STATUS::FAIL)
+  if (encoded.size() < size)
   {
-    encoded.push_back(curr_byte);
+    cout << "diff_at: " << encoded.size() << " " << endl;
+    return 1;
   }
-  
-  for (int i = 0; i < size; ++i)
+
+  for (size_t i = 0; i < size; ++i)
   {
     if (encoded[i] != (uint8_t)( midi_contents[i] ))
     {
@@ -86,7 +71,34 @@ int main(int argc, char **argv)
   Write serialized data to new file
   ****************************************/
   file_writer.open(file_out,ios::out | ios :: binary );
-  file_writer.write((char*)&(encoded[0]), encoded.size());
+
+  {
+    MIDI_Ostream_Sink sink(file_writer);
+    enc.set_data(&decoded);
+    enc.encode_to(sink);
+  }
+
+  file_writer.close();
+
+  /****************************************
+  Check the streamed output file
+  ****************************************/
+  MIDI_File_Loader written{};
+
+  if (!written.open(file_out) || (written.get_size() != encoded.size()))
+  {
+    cout << "stream_diff_at: " << written.get_size() << " " << endl;
+    return 1;
+  }
+
+  for (size_t i = 0; i < written.get_size(); ++i)
+  {
+    if (written.get_data()[i] != encoded[i])
+    {
+      cout << "stream_diff_at: " << i << " " << endl;
+      return 1;
+    }
+  }
   
   cout << "complete" << endl;
   
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "MIDI_Data.h"
+#include "MIDI_Encoder.h"
+
+using namespace std;
+
+/*
+Regression benchmark for MTrk encoding. Synthetic single-track files of
+increasing size are encoded and the time per event of the largest track is
+compared against the smallest. A linear encoder keeps the ratio close to 1;
+anything that walks the track per event makes it grow with the track length.
+It compares run times, so it is run by `make encode_scaling` rather than by
+`make tests`.
+*/
+
+static const size_t  sizes[]     = {125000, 250000, 500000, 1000000};
+static const int     repeats     = 3;
+static const double  max_ratio   = 3.0; // per-event cost at 1M vs 125k events (8.0 if quadratic)
+
+static void build_track(MIDI_File& file, size_t event_count)
+{
+  MTrk_Chunk& track = file.emplace_back_mtrk();
+
+  for (size_t i = 0; i < event_count; ++i)
+  {
+    MTrk_Event& event = track.emplace_back_event();
+    event.set_dt((uint32_t)(i % 96));
+
+    // alternate note on/off so both running status and explicit status bytes are encoded
+    event.push_byte(((i / 4) % 2) ? STATUS_BYTE::NOTE_OFF : STATUS_BYTE::NOTE_ON);
+    event.push_byte((uint8_t)(i % 128));
+    event.push_byte(0x40);
+  }
+
+  MTrk_Event& end_of_track = track.emplace_back_event();
+  end_of_track.push_byte(STATUS_BYTE::META);
+  end_of_track.push_byte(0x2F);
+  end_of_track.push_byte(0x00);
+
+  file.get_hdr().set_len(6);
+  file.get_hdr().set_fmt(0);
+  file.get_hdr().set_ntrks(1);
+  file.get_hdr().set_div(96);
+}
+
+static double encode_seconds(MIDI_File& file, size_t& encoded_size)
+{
+  double best = 0;
+
+  for (int r = 0; r < repeats; ++r)
+  {
+    MIDI_File_Encoder enc{};
+    vector<uint8_t> encoded{};
+    uint8_t curr_byte{};
+
+    encoded.reserve(file[0].size() * 4 + 64);
+
+    auto start = chrono::steady_clock::now();
+
+    enc.set_data(&file);
+    while (enc.encode_byte(curr_byte) != MIDI_Element_Encoder::STATUS::FAIL)
+    {
+      encoded.push_back(curr_byte);
+    }
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if ((r == 0) || (elapsed < best))
+    {
+      best = elapsed;
+    }
+
+    encoded_size = encoded.size();
+  }
+
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  vector<double> ns_per_event{};
+  vector<size_t> encoded_sizes{};
+
+  for (size_t event_count : sizes)
+  {
+    MIDI_File file{};
+    size_t encoded_size{};
+
+    build_track(file, event_count);
+
+    double seconds = encode_seconds(file, encoded_size);
+
+    ns_per_event.push_back(seconds * 1e9 / (double)event_count);
+    encoded_sizes.push_back(encoded_size);
+  }
+
+  double ratio = ns_per_event.back() / ns_per_event.front();
+
+  cout << ((ratio <= max_ratio) ? "complete" : "fail") << endl;
+
+  for (size_t i = 0; i < ns_per_event.size(); ++i)
+  {
+    cout << "events: " << sizes[i] << " bytes: " << encoded_sizes[i] << " ns/event: " << ns_per_event[i] << endl;
+  }
+
+  cout << "ratio: " << ratio << endl;
+
+  return (ratio <= max_ratio) ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_View.h"
+
+using namespace std;
+
+/*
+Checks the time index of `MTrk_Chunk`. Every track of every file given on the
+command line, and of a generated file with long tracks, must report the
+absolute tick of each event, seek to the first event at or after any tick, and
+give checkpoints whose offset and running status locate their event in the
+encoded file. The tracks are then edited one change at a time (delta times,
+inserts, erases, moves, move assignments and a status change), and after every
+change the index must match that of a fresh copy of the track. Ticks and
+checkpoints asked for past the last event are those of the last event.
+*/
+
+static bool check_ticks(MTrk_Chunk& track)
+{
+  vector<uint64_t> expected{};
+  uint64_t tick = 0;
+
+  for (MTrk_Event& event : track)
+  {
+    tick += event.get_dt();
+    expected.push_back(tick);
+  }
+
+  for (size_t i = 0; i < track.size(); ++i)
+  {
+    if (track.get_tick(i) != expected[i])
+    {
+      return false;
+    }
+  }
+
+  // every event tick, and the ticks either side of it
+  for (size_t i = 0; i < expected.size(); ++i)
+  {
+    for (uint64_t target : {expected[i] - (expected[i] > 0), expected[i], expected[i] + 1})
+    {
+      size_t first = (size_t)(lower_bound(expected.begin(), expected.end(), target) - expected.begin());
+
+      if (track.seek(target) != first)
+      {
+        return false;
+      }
+    }
+  }
+
+  // past the last event
+  return (track.seek(tick + 1) == track.size()) && (track.get_tick(track.size()) == tick) &&
+         (track.get_tick(track.size() + 100) == tick);
+}
+
+static bool check_checkpoints(MTrk_Chunk& track, const uint8_t* body, uint32_t len)
+{
+  for (size_t i = 0; i < track.size(); i += MTrk_Chunk::CHECKPOINT_INTERVAL)
+  {
+    MTrk_Checkpoint checkpoint = track.get_checkpoint(i + MTrk_Chunk::CHECKPOINT_INTERVAL - 1);
+    MTrk_Event& event = track[i];
+    uint32_t dt = 0;
+
+    if ((checkpoint.event != i) || (checkpoint.tick != track.get_tick(i)) || (checkpoint.offset >= len))
+    {
+      return false;
+    }
+
+    int count = Varlen::decode(body + checkpoint.offset, body + len, dt);
+
+    if ((count == 0) || (dt != event.get_dt()) || (checkpoint.offset + count >= len))
+    {
+      return false;
+    }
+
+    // the status byte is left out exactly when it repeats the running status
+    bool omitted = (body[checkpoint.offset + count] < 0x80);
+    bool expected = (checkpoint.running_status != 0) && (checkpoint.running_status == event.get_status()) &&
+                    (event.get_payload_size() > 1);
+
+    if ((omitted != expected) || (!omitted && (body[checkpoint.offset + count] != event.get_status())))
+    {
+      return false;
+    }
+
+    // meta and sysex events reset running status
+    if ((i > 0) && (track[i - 1].get_status_class() != STATUS_CLASS::CHANNEL) && (checkpoint.running_status != 0))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool same_index(MTrk_Chunk& track)
+{
+  MTrk_Chunk fresh(track);
+
+  if (fresh.size() != track.size())
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < track.size(); ++i)
+  {
+    MTrk_Checkpoint a = track.get_checkpoint(i);
+    MTrk_Checkpoint b = fresh.get_checkpoint(i);
+
+    if ((track.get_tick(i) != fresh.get_tick(i)) || (a.event != b.event) || (a.tick != b.tick) ||
+        (a.offset != b.offset) || (a.running_status != b.running_status))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool edit_track(MTrk_Chunk& track)
+{
+  size_t count = track.size();
+  bool match = true;
+
+  if (count < 4)
+  {
+    return true;
+  }
+
+  // build the index, then change it from the middle, the end and the front
+  track.seek(0);
+
+  track[count / 2].set_dt(track[count / 2].get_dt() + 7);
+  match = match && same_index(track);
+
+  track.erase(count - 2);
+  match = match && same_index(track);
+
+  track.erase(count / 5);
+  match = match && same_index(track);
+
+  track.insert_event(count / 3, track[count - 3]);
+  match = match && same_index(track);
+
+  track.insert_event(0, std::move(track[track.size() - 1]));
+  track.erase(track.size() - 1);
+  match = match && same_index(track);
+
+  // move assignment of a detached event and of an event of the track
+  MTrk_Event moved{};
+  moved.set_dt(track[count / 3].get_dt() + 11);
+  moved.push_byte(0xC0);
+  moved.push_byte(0x05);
+  track[count / 3] = std::move(moved);
+  match = match && same_index(track);
+
+  track[count / 6] = std::move(track[count / 2]);
+  match = match && same_index(track);
+
+  // a status change turns running status on or off for the next event
+  MTrk_Event& note = track.emplace_event(count / 4);
+  note.push_byte(0x91);
+  note.push_byte(0x40);
+  note.push_byte(0x40);
+  match = match && same_index(track) && check_ticks(track);
+
+  track.drop_index();
+  match = match && same_index(track) && check_ticks(track);
+
+  MTrk_Checkpoint last = track.get_checkpoint(track.size() - 1);
+  MTrk_Checkpoint past = track.get_checkpoint(track.size() + 100);
+  match = match && (past.event == last.event) && (past.offset == last.offset);
+
+  track.clear();
+  match = match && (track.seek(0) == 0) && (track.get_tick(0) == 0) && (track.get_checkpoint(0).event == 0);
+
+  return match;
+}
+
+static void build_file(MIDI_File& file)
+{
+  // notes under running status, broken by controllers on another channel and by metas
+  for (size_t t = 0; t < 3; ++t)
+  {
+    MTrk_Chunk& track = file.emplace_back_mtrk();
+
+    for (size_t i = 0; i < 5000; ++i)
+    {
+      MTrk_Event& event = track.emplace_back_event();
+      event.set_dt((uint32_t)((i % 5) ? (i % 7) : (i * 131 % 20000)));
+
+      if ((i % 97) == 0)
+      {
+        event.push_byte(STATUS_BYTE::META);
+        event.push_byte(0x01);
+        event.push_byte(0x01);
+        event.push_byte((uint8_t)'x');
+      }
+      else if ((i % 13) == 0)
+      {
+        event.push_byte((uint8_t)(0xB0 | t));
+        event.push_byte(0x07);
+        event.push_byte((uint8_t)(i % 128));
+      }
+      else
+      {
+        event.push_byte(0x90);
+        event.push_byte((uint8_t)(i % 128));
+        event.push_byte((uint8_t)((i % 2) ? 0x40 : 0x00));
+      }
+    }
+
+    MTrk_Event& end_of_track = track.emplace_back_event();
+    end_of_track.push_byte(STATUS_BYTE::META);
+    end_of_track.push_byte(0x2F);
+    end_of_track.push_byte(0x00);
+  }
+
+  file.get_hdr().set_len(6);
+  file.get_hdr().set_fmt(1);
+  file.get_hdr().set_ntrks(3);
+  file.get_hdr().set_div(480);
+}
+
+static bool compare_decoded(MIDI_File& file)
+{
+  MIDI_File_View view{};
+  vector<uint8_t> encoded{};
+  size_t next = 0;
+  bool match = true;
+
+  if (!encode_file(file, encoded) ||
+      (view.index(encoded.data(), encoded.size()) != MIDI_Element_Decoder::STATUS::SUCCESS))
+  {
+    return false;
+  }
+
+  for (size_t i = 0; match && (i < file.get_hdr().get_ntrks()); ++i)
+  {
+    if (file.get_chunk(i).get_header() != CHUNK_HEADER::MTRK)
+    {
+      continue;
+    }
+
+    MTrk_Chunk& track = static_cast<MTrk_Chunk&>(file.get_chunk(i));
+    MTrk_View& encoded_track = view.get_MTrk(next++);
+
+    match = check_ticks(track) && check_checkpoints(track, encoded_track.get_body(), encoded_track.get_len()) &&
+            edit_track(track);
+  }
+
+  return match;
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File decoded{};
+
+  if (!decode_file(data, size, decoded))
+  {
+    return true; // nothing to compare
+  }
+
+  return compare_decoded(decoded);
+}
+
+static bool check_generated()
+{
+  MIDI_File generated{};
+
+  build_file(generated);
+
+  return compare_decoded(generated);
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file, {{"generated", check_generated}});
+}
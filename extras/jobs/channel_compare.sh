@@ -0,0 +1,10 @@
+test_dir=$(dirname ${BASH_SOURCE[0]})
+${test_dir}/../channel_compare $(find ${test_dir}/../MIDI_files -maxdepth 1 -type f -name \*.mid | sort) > ${test_dir}/results/channel_compare.txt
+
+result=$(head -n 1 ${test_dir}/results/channel_compare.txt)
+
+if [ "$result" = "complete" ]; then
+    echo "pass"
+else
+    echo "fail"
+fi
@@ -0,0 +1,11 @@
+test_dir=$(dirname ${BASH_SOURCE[0]})
+${test_dir}/../decode_reencode ${test_dir}/../MIDI_files/empty_sysex.mid ${test_dir}/encoded_files/empty_sysex.mid > ${test_dir}/results/empty_sysex.txt
+
+result=$(head -n 1 ${test_dir}/results/empty_sysex.txt)
+
+if [ "$result" = "complete" ]; then
+    echo "pass"
+else
+    echo "fail"
+fi
+
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+
+using namespace std;
+
+/*
+Checks copying and moving of files, chunks and events: every file given on the
+command line is decoded, then copied, moved, rebuilt by moving its chunks into
+another file in reverse order and back, and has every track rotated one event
+at a time with `insert_event(0, std::move(track[last]))`. Each result must
+re-encode to the same bytes as the decoded file, and a move must not copy any
+payload: the payloads too long to be stored in an event stay where they were.
+Tracks moved out of a file, into one with the same or another memory resource,
+must be left empty, and an event moved out of a track must keep its bytes once
+the track's arena is reused.
+*/
+
+static void long_payloads(MIDI_File& file, vector<const uint8_t*>& payloads)
+{
+  payloads.clear();
+
+  for (size_t i = 0; i < file.get_hdr().get_ntrks(); ++i)
+  {
+    if (file.get_chunk(i).get_header() != CHUNK_HEADER::MTRK)
+    {
+      continue;
+    }
+
+    for (MTrk_Event& event : static_cast<MTrk_Chunk&>(file.get_chunk(i)))
+    {
+      if (event.get_payload_size() > MTrk_Event::INLINE_CAPACITY)
+      {
+        payloads.push_back(event.get_payload());
+      }
+    }
+  }
+}
+
+static void reverse_chunks(MIDI_File& from, MIDI_File& to)
+{
+  size_t count = (size_t)from.get_hdr().get_ntrks();
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    MIDI_Chunk& chunk = from.get_chunk(i);
+
+    if (chunk.get_header() == CHUNK_HEADER::MTRK)
+    {
+      to.insert_mtrk(0, std::move(static_cast<MTrk_Chunk&>(chunk)));
+    }
+    else
+    {
+      to.insert_unkn(0, std::move(static_cast<UNkn_Chunk&>(chunk)));
+    }
+  }
+
+  to.get_hdr() = from.get_hdr();
+}
+
+static bool emptied(MIDI_File& file)
+{
+  // tracks moved out of a file are left empty, with no length and no index
+  for (size_t i = 0; i < file.get_hdr().get_ntrks(); ++i)
+  {
+    if (file.get_chunk(i).get_header() != CHUNK_HEADER::MTRK)
+    {
+      continue;
+    }
+
+    MTrk_Chunk& track = static_cast<MTrk_Chunk&>(file.get_chunk(i));
+
+    if ((track.size() != 0) || (track.get_len() != 0) || (track.seek(0) != 0) || (track.get_tick(0) != 0))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool rotate_tracks(MIDI_File& file, bool replace_ends)
+{
+  for (size_t i = 0; i < file.get_hdr().get_ntrks(); ++i)
+  {
+    if (file.get_chunk(i).get_header() != CHUNK_HEADER::MTRK)
+    {
+      continue;
+    }
+
+    MTrk_Chunk& track = static_cast<MTrk_Chunk&>(file.get_chunk(i));
+    size_t count = track.size();
+    uint32_t len = track.get_len();
+
+    if (count == 0)
+    {
+      continue;
+    }
+
+    if (!replace_ends)
+    {
+      for (size_t n = 0; n < count; ++n)
+      {
+        track.insert_event(0, std::move(track[count - 1]));
+        track.erase(count);
+      }
+    }
+    else
+    {
+      // a detached event is moved in, and an event of another chunk copied
+      MTrk_Event detached(track[0]);
+      MTrk_Chunk other{};
+      other.insert_event(0, track[count - 1]);
+
+      track.insert_event(0, std::move(detached));
+      track.erase(1);
+      track.insert_event(count, std::move(other[0]));
+      track.erase(count - 1);
+
+      if ((detached.get_payload_size() != 0) || (other[0].get_payload_size() != 0))
+      {
+        return false;
+      }
+    }
+
+    if ((track.size() != count) || (track.get_len() != len))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool move_out(MIDI_File& file)
+{
+  // an event moved out of a track is detached: the track keeps its bytes, and the
+  // event keeps a copy after the track's arena is reused
+  for (size_t i = 0; i < file.get_hdr().get_ntrks(); ++i)
+  {
+    if (file.get_chunk(i).get_header() != CHUNK_HEADER::MTRK)
+    {
+      continue;
+    }
+
+    MTrk_Chunk& track = static_cast<MTrk_Chunk&>(file.get_chunk(i));
+    size_t count = track.size();
+    uint32_t len = track.get_len();
+    size_t index = 0;
+
+    while ((index + 1 < count) && (track[index].get_payload_size() <= MTrk_Event::INLINE_CAPACITY))
+    {
+      ++index; // prefer a payload kept in the arena
+    }
+
+    if (count == 0)
+    {
+      continue;
+    }
+
+    vector<uint8_t> bytes(track[index].get_payload(), track[index].get_payload() + track[index].get_payload_size());
+    MTrk_Event moved(std::move(track[index]));
+
+    if ((track.size() != count) || (track.get_len() != len) ||
+        !equal(bytes.begin(), bytes.end(), track[index].get_payload(), track[index].get_payload() + track[index].get_payload_size()))
+    {
+      return false;
+    }
+
+    track.clear();
+
+    for (size_t n = 0; n < count; ++n)
+    {
+      MTrk_Event& filler = track.emplace_back_event();
+      filler.push_byte(STATUS_BYTE::META);
+      filler.push_byte(0x01);
+      filler.push_byte(0x20);
+
+      for (size_t b = 0; b < 0x20; ++b)
+      {
+        filler.push_byte((uint8_t)'z');
+      }
+    }
+
+    if (!equal(bytes.begin(), bytes.end(), moved.get_payload(), moved.get_payload() + moved.get_payload_size()))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File decoded{};
+  vector<uint8_t> expected{};
+
+  if (!decode_file(data, size, decoded))
+  {
+    return true; // nothing to compare
+  }
+
+  if (!encode_file(decoded, expected))
+  {
+    return false;
+  }
+
+  vector<const uint8_t*> before{};
+  vector<const uint8_t*> after{};
+
+  // a copy has chunks of its own
+  MIDI_File copy(decoded);
+  bool match = same_bytes(copy, expected);
+
+  for (size_t i = 0; match && (i < copy.get_hdr().get_ntrks()); ++i)
+  {
+    match = (&copy.get_chunk(i) != &decoded.get_chunk(i));
+  }
+
+  // moving the file, or its chunks one by one, keeps every payload in place
+  long_payloads(copy, before);
+
+  MIDI_File moved(std::move(copy));
+  MIDI_File reversed{};
+  MIDI_File restored{};
+
+  match = match && same_bytes(moved, expected);
+
+  for (size_t i = 0; i < moved.get_hdr().get_ntrks(); ++i)
+  {
+    if (moved.get_chunk(i).get_header() == CHUNK_HEADER::MTRK)
+    {
+      static_cast<MTrk_Chunk&>(moved.get_chunk(i)).seek(0); // moved with its index
+    }
+  }
+
+  reverse_chunks(moved, reversed);
+  reverse_chunks(reversed, restored);
+  match = match && emptied(moved) && emptied(reversed);
+
+  long_payloads(restored, after);
+  match = match && same_bytes(restored, expected) && (before == after);
+
+  // rotating a track all the way round moves each event once, without copying
+  match = match && rotate_tracks(restored, false) && same_bytes(restored, expected);
+
+  long_payloads(restored, after);
+  match = match && (before == after);
+
+  match = match && rotate_tracks(restored, true) && same_bytes(restored, expected);
+
+  // chunks moved into a file with another memory resource are copied, and still emptied
+  std::pmr::monotonic_buffer_resource resource{};
+  MIDI_File pooled(MIDI_File::allocator_type{&resource});
+  MIDI_File turned{};
+
+  reverse_chunks(restored, turned);
+  reverse_chunks(turned, pooled);
+  match = match && emptied(restored) && emptied(turned) && same_bytes(pooled, expected);
+
+  // assignment replaces what was there
+  moved = decoded;
+  restored = std::move(moved);
+  match = match && same_bytes(restored, expected);
+
+  // moving an event out of a track copies it
+  MIDI_File edited(decoded);
+  match = match && move_out(edited);
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file);
+}
@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_Scanner.h"
+
+using namespace std;
+
+/*
+Checks MIDI_Scanner against MIDI_File_Decoder: for every file given on the
+command line and with every kernel the machine supports, `validate` must accept
+exactly the files `decode` accepts and report the same chunks, event counts and
+arena bytes, and a track decoded with those counts must fit the table and arena
+reserved from them. `find_header` must find the MThd chunk again once the file is
+moved behind a prefix of every length from 0 to 99 bytes.
+*/
+
+static const MIDI_Scanner::KERNEL kernels[] = {MIDI_Scanner::KERNEL::SCALAR, MIDI_Scanner::KERNEL::SSE2, MIDI_Scanner::KERNEL::AVX2};
+
+static bool compare_scan(MIDI_File& decoded, MIDI_Scanner& scanner)
+{
+  if (scanner.get_chunk_count() != ((size_t)decoded.get_hdr().get_ntrks() + 1))
+  {
+    return false;
+  }
+
+  size_t mtrk_index = 0;
+  size_t total_events = 0;
+
+  for (size_t i = 1; i < scanner.get_chunk_count(); ++i)
+  {
+    MIDI_Chunk_Span& span = scanner.get_chunk(i);
+
+    if (span.header != decoded.get_chunk(i - 1).get_header())
+    {
+      return false;
+    }
+
+    if (span.header == CHUNK_HEADER::MTRK)
+    {
+      MTrk_Chunk& track = decoded[mtrk_index++];
+      size_t bytes = 0;
+
+      for (MTrk_Event& event : track)
+      {
+        if (event.get_payload_size() > MTrk_Event::INLINE_CAPACITY)
+        {
+          bytes += event.get_payload_size();
+        }
+      }
+
+      if ((span.event_count != track.size()) || (span.byte_count != bytes))
+      {
+        return false;
+      }
+
+      // decoded with the counts, the table and the arena never grow past their reservation
+      MTrk_Chunk_Decoder track_dec{};
+      MTrk_Chunk reserved{};
+
+      if ((track_dec.decode(span.body, span.len, reserved, span.event_count, span.byte_count) != MIDI_Element_Decoder::STATUS::SUCCESS) ||
+          (reserved.size() != track.size()) || (reserved.get_capacity() != span.event_count) ||
+          (reserved.get_arena_capacity() != span.byte_count))
+      {
+        return false;
+      }
+
+      total_events += track.size();
+    }
+  }
+
+  return (scanner.get_event_count() == total_events);
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File decoded{};
+
+  bool decode_ok = decode_file(data, size, decoded);
+  vector<uint8_t> wrapped{};
+
+  for (MIDI_Scanner::KERNEL kernel : kernels)
+  {
+    MIDI_Scanner scanner{};
+
+    if (!scanner.set_kernel(kernel))
+    {
+      continue;
+    }
+
+    bool scan_ok = (scanner.validate(data, size) == MIDI_Element_Decoder::STATUS::SUCCESS);
+
+    if ((scan_ok != decode_ok) || (scan_ok && !compare_scan(decoded, scanner)))
+    {
+      return false;
+    }
+
+    for (size_t prefix = 0; prefix < 100; ++prefix)
+    {
+      wrapped.assign(prefix, 'M'); // partial tag bytes must not match
+      wrapped.insert(wrapped.end(), data, data + size);
+
+      size_t expected = ((size >= 4) && (scanner.find_header(data, size, CHUNK_HEADER::MTHD) == 0)) ? prefix : wrapped.size();
+
+      if (scanner.find_header(wrapped.data(), wrapped.size(), CHUNK_HEADER::MTHD) != expected)
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file);
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_Encoder.h"
+#include "MIDI_Sink.h"
+#include "MIDI_Stats.h"
+
+using namespace std;
+
+/*
+Checks the counters of a library built with -DMIDI_STATS. Every file given on
+the command line is decoded with `decode`, `decode_byte`, `decode` in small
+blocks and `decode_parallel`, and the decoded file is encoded with both
+`encode_to` overloads, `encode_parallel` and `encode_byte`. All decoders must
+report the same counters, as must all encoders; their chunk entries must add
+up to the bytes read or written and their event counts to the events of the
+file. When the file re-encodes to its own bytes the encoders must report what
+the decoders did. Decoding the file again into the same, cleared `MIDI_File`
+must not allocate.
+*/
+
+static bool same_counts(const MIDI_Stats& a, const MIDI_Stats& b)
+{
+  bool same = (a.mthd_bytes == b.mthd_bytes) && (a.mtrk_bytes == b.mtrk_bytes) && (a.unkn_bytes == b.unkn_bytes) &&
+              (a.channel_events == b.channel_events) && (a.meta_events == b.meta_events) &&
+              (a.sysex_events == b.sysex_events) && (a.running_status == b.running_status) &&
+              (a.chunks.size() == b.chunks.size());
+
+  for (size_t i = 0; same && (i < 5); ++i)
+  {
+    same = (a.dt_varlen[i] == b.dt_varlen[i]) && (a.length_varlen[i] == b.length_varlen[i]);
+  }
+
+  for (size_t i = 0; same && (i < a.chunks.size()); ++i)
+  {
+    same = (a.chunks[i].header == b.chunks[i].header) && (a.chunks[i].bytes == b.chunks[i].bytes) &&
+           (a.chunks[i].events == b.chunks[i].events);
+  }
+
+  return same;
+}
+
+static bool adds_up(const MIDI_Stats& stats, uint64_t bytes, uint64_t events)
+{
+  uint64_t chunk_bytes = 0;
+  uint64_t chunk_events = 0;
+  uint64_t dt_count = 0;
+
+  for (const MIDI_Chunk_Stats& chunk : stats.chunks)
+  {
+    chunk_bytes += chunk.bytes;
+    chunk_events += chunk.events;
+  }
+
+  for (size_t i = 0; i < 5; ++i)
+  {
+    dt_count += stats.dt_varlen[i];
+  }
+
+  return (chunk_bytes == bytes) && (stats.mthd_bytes + stats.mtrk_bytes + stats.unkn_bytes == bytes) &&
+         (chunk_events == events) && (stats.channel_events + stats.meta_events + stats.sysex_events == events) &&
+         (dt_count == events) && (stats.dt_varlen[0] == 0) && (stats.length_varlen[0] == 0) &&
+         (stats.length_varlen[1] + stats.length_varlen[2] + stats.length_varlen[3] + stats.length_varlen[4] ==
+          stats.meta_events + stats.sysex_events);
+}
+
+static uint64_t count_events(MIDI_File& file)
+{
+  uint64_t events = 0;
+
+  for (size_t i = 0; i < file.get_hdr().get_ntrks(); ++i)
+  {
+    if (file.get_chunk(i).get_header() == CHUNK_HEADER::MTRK)
+    {
+      events += static_cast<MTrk_Chunk&>(file.get_chunk(i)).size();
+    }
+  }
+
+  return events;
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File_Decoder dec{};
+  MIDI_File decoded{};
+
+  if (dec.decode(data, size, decoded) != MIDI_Element_Decoder::STATUS::SUCCESS)
+  {
+    return true; // nothing to compare
+  }
+
+  MIDI_Stats expected = dec.get_stats();
+  uint64_t read = dec.get_index();
+  uint64_t events = count_events(decoded);
+  bool match = adds_up(expected, read, events) && ((events == 0) || (expected.allocations > 0));
+
+  /****************************************
+  Every decoder reports the same
+  ****************************************/
+  for (int method = 0; match && (method < 3); ++method)
+  {
+    MIDI_File other{};
+    MIDI_File_Decoder other_dec{};
+
+    switch (method)
+    {
+      case 0:
+      {
+        for (size_t i = 0; (i < size) && (other_dec.get_index() < read); ++i)
+        {
+          other_dec.decode_byte(data[i], &other);
+        }
+        break;
+      }
+      case 1:
+      {
+        for (size_t pos = 0, block = 1; pos < read; pos += block, block = block % 61 + 7)
+        {
+          other_dec.decode(data + pos, min<size_t>(block, read - pos), other);
+        }
+        break;
+      }
+      default:
+      {
+        other_dec.decode_parallel(data, size, other, 3);
+        break;
+      }
+    }
+
+    match = same_counts(other_dec.get_stats(), expected);
+  }
+
+  // a reused file has room for the same file already
+  decoded.clear();
+  dec.clear();
+  match = match && (dec.decode(data, size, decoded) == MIDI_Element_Decoder::STATUS::SUCCESS) &&
+          same_counts(dec.get_stats(), expected) && (dec.get_stats().allocations == 0);
+
+  /****************************************
+  Every encoder reports the same
+  ****************************************/
+  MIDI_File_Encoder enc{};
+  vector<uint8_t> encoded{};
+
+  enc.set_data(&decoded);
+  match = match && (enc.encode_to(encoded) == MIDI_Element_Encoder::STATUS::SUCCESS);
+
+  MIDI_Stats written = enc.get_stats();
+  match = match && adds_up(written, encoded.size(), events);
+
+  if (match && (encoded.size() == read) && equal(encoded.begin(), encoded.end(), data))
+  {
+    match = same_counts(written, expected);
+  }
+
+  for (int method = 0; match && (method < 3); ++method)
+  {
+    MIDI_File_Encoder other_enc{};
+    vector<uint8_t> other_bytes{};
+    ostringstream stream{};
+    uint8_t next_byte{};
+
+    other_enc.set_data(&decoded);
+
+    switch (method)
+    {
+      case 0:
+      {
+        MIDI_Ostream_Sink sink(stream, 64);
+        other_enc.encode_to(sink);
+        break;
+      }
+      case 1:
+      {
+        other_enc.encode_parallel(other_bytes, 3);
+        break;
+      }
+      default:
+      {
+        while (other_enc.encode_byte(next_byte) != MIDI_Element_Encoder::STATUS::FAIL)
+        {
+        }
+        break;
+      }
+    }
+
+    match = same_counts(other_enc.get_stats(), written);
+  }
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file);
+}
@@ -0,0 +1,171 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_Encoder.h"
+
+using namespace std;
+
+/*
+Microbenchmark for status byte classification. A dense single-track note stream
+(every event a channel message, mostly under running status) is decoded one byte
+at a time, decoded in bulk and encoded one byte at a time; each is reported in
+events per second, best of `repeats`. The classification itself is timed by
+calling MIDI_Event_Decoder::get_parameter_count on every status byte of the
+stream.
+*/
+
+static const size_t  event_count = 1000000;
+static const int     repeats     = 5;
+
+static void build_track(MIDI_File& file)
+{
+  MTrk_Chunk& track = file.emplace_back_mtrk();
+
+  for (size_t i = 0; i < event_count; ++i)
+  {
+    MTrk_Event& event = track.emplace_back_event();
+    event.set_dt((uint32_t)(i % 4));
+
+    switch (i % 16)
+    {
+      case 7:
+      {
+        event.push_byte(0xB0 | (uint8_t)(i % 16)); // control change
+        event.push_byte(0x07);
+        event.push_byte((uint8_t)(i % 128));
+        break;
+      }
+      case 15:
+      {
+        event.push_byte(0xC0 | (uint8_t)(i % 16)); // program change
+        event.push_byte((uint8_t)(i % 128));
+        break;
+      }
+      default:
+      {
+        event.push_byte(((i / 32) % 2) ? 0x80 : 0x90);
+        event.push_byte((uint8_t)((i * 7) % 128));
+        event.push_byte(0x40);
+        break;
+      }
+    }
+  }
+
+  MTrk_Event& end_of_track = track.emplace_back_event();
+  end_of_track.push_byte(STATUS_BYTE::META);
+  end_of_track.push_byte(0x2F);
+  end_of_track.push_byte(0x00);
+
+  file.get_hdr().set_len(6);
+  file.get_hdr().set_fmt(0);
+  file.get_hdr().set_ntrks(1);
+  file.get_hdr().set_div(96);
+}
+
+template <class F>
+static double best_seconds(F run)
+{
+  double best = 0;
+
+  for (int r = 0; r < repeats; ++r)
+  {
+    auto start = chrono::steady_clock::now();
+    run();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if ((r == 0) || (elapsed < best))
+    {
+      best = elapsed;
+    }
+  }
+
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  MIDI_File file{};
+  vector<uint8_t> encoded{};
+  vector<uint8_t> statuses{};
+  bool ok = true;
+
+  build_track(file);
+
+  MIDI_File_Encoder enc{};
+  enc.set_data(&file);
+  ok = ok && (enc.encode_to(encoded) == MIDI_Element_Encoder::STATUS::SUCCESS);
+
+  for (MTrk_Event& event : file[0])
+  {
+    statuses.push_back(event.get_status());
+  }
+
+  size_t total_events = file[0].size();
+  volatile uint32_t sink = 0;
+
+  double classify = best_seconds([&]()
+  {
+    uint32_t sum = 0;
+    uint8_t count = 0;
+
+    for (uint8_t status : statuses)
+    {
+      if (MIDI_Event_Decoder::get_parameter_count(status, count) == MIDI_Element_Decoder::STATUS::SUCCESS)
+      {
+        sum += count;
+      }
+    }
+
+    sink = sink + sum;
+  });
+
+  double decode_bytes = best_seconds([&]()
+  {
+    MIDI_File decoded{};
+    MIDI_File_Decoder dec{};
+
+    for (uint8_t next_byte : encoded)
+    {
+      dec.decode_byte(next_byte, &decoded);
+    }
+
+    ok = ok && (decoded[0].size() == total_events);
+  });
+
+  double decode_bulk = best_seconds([&]()
+  {
+    MIDI_File decoded{};
+    MIDI_File_Decoder dec{};
+
+    ok = ok && (dec.decode(encoded.data(), encoded.size(), decoded) == MIDI_Element_Decoder::STATUS::SUCCESS);
+  });
+
+  double encode_bytes = best_seconds([&]()
+  {
+    MIDI_File_Encoder byte_enc{};
+    uint8_t curr_byte{};
+    size_t produced = 0;
+
+    byte_enc.set_data(&file);
+
+    while (byte_enc.encode_byte(curr_byte) != MIDI_Element_Encoder::STATUS::FAIL)
+    {
+      ++produced;
+    }
+
+    ok = ok && (produced == encoded.size());
+  });
+
+  cout << (ok ? "complete" : "fail") << endl;
+  cout << "events: " << total_events << " bytes: " << encoded.size() << endl;
+  cout << "classify Mstatus/s: "       << (double)total_events / classify / 1e6     << endl;
+  cout << "decode_byte Mevents/s: "    << (double)total_events / decode_bytes / 1e6 << endl;
+  cout << "decode (bulk) Mevents/s: "  << (double)total_events / decode_bulk / 1e6  << endl;
+  cout << "encode_byte Mevents/s: "    << (double)total_events / encode_bytes / 1e6 << endl;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+
+using namespace std;
+
+/*
+Checks MIDI_Stream_Decoder against MIDI_File_Decoder: every file given on the
+command line is fed to the stream decoder in blocks of pseudo-random size, and
+the callbacks must report the same header, tracks and events. All the files the
+decoders accepted, damaged copies included, are then fed again back to back as
+one concatenated stream.
+*/
+
+struct Stream_File
+{
+  MThd_Chunk hdr{};
+  vector<uint32_t> headers{};
+  vector<MTrk_Chunk> tracks{};
+};
+
+class Recorder : public MIDI_Stream_Handler
+{
+public:
+  vector<Stream_File> files{};
+  bool order_ok{true};
+  bool in_track{false};
+
+  void on_header(MThd_Chunk& hdr)
+  {
+    order_ok = order_ok && !in_track;
+    files.emplace_back();
+    files.back().hdr = hdr;
+  }
+
+  void on_track_begin(size_t track_index, uint32_t len)
+  {
+    order_ok = order_ok && !in_track && !files.empty() && (track_index == files.back().tracks.size());
+    in_track = true;
+    files.back().headers.push_back(CHUNK_HEADER::MTRK);
+    files.back().tracks.emplace_back();
+  }
+
+  void on_event(MTrk_Event& event)
+  {
+    order_ok = order_ok && in_track;
+
+    MTrk_Event& copy = files.back().tracks.back().emplace_back_event();
+    copy.set_dt(event.get_dt());
+    copy.push_bytes(event.get_payload(), event.get_payload_size());
+  }
+
+  void on_track_end(size_t track_index)
+  {
+    order_ok = order_ok && in_track && ((track_index + 1) == files.back().tracks.size());
+    in_track = false;
+  }
+
+  void on_unknown_chunk(uint32_t header, uint32_t len)
+  {
+    order_ok = order_ok && !in_track && !files.empty();
+    files.back().headers.push_back(header);
+  }
+};
+
+static bool same_tracks(MTrk_Chunk& a, MTrk_Chunk& b)
+{
+  if (a.size() != b.size())
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    if ((a[i].get_dt() != b[i].get_dt()) || (a[i].get_payload_size() != b[i].get_payload_size()))
+    {
+      return false;
+    }
+
+    for (uint32_t j = 0; j < a[i].get_payload_size(); ++j)
+    {
+      if (a[i][j] != b[i][j])
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static bool same_files(MIDI_File& a, Stream_File& b)
+{
+  MThd_Chunk& ha = a.get_hdr();
+
+  if ((ha.get_len() != b.hdr.get_len()) || (ha.get_fmt() != b.hdr.get_fmt()) ||
+      (ha.get_ntrks() != b.hdr.get_ntrks()) || (ha.get_div() != b.hdr.get_div()) ||
+      (b.headers.size() != ha.get_ntrks()))
+  {
+    return false;
+  }
+
+  size_t mtrk_index = 0;
+
+  for (size_t i = 0; i < ha.get_ntrks(); ++i)
+  {
+    if (a.get_chunk(i).get_header() != b.headers[i])
+    {
+      return false;
+    }
+
+    if (b.headers[i] == CHUNK_HEADER::MTRK)
+    {
+      if (!same_tracks(a[mtrk_index], b.tracks[mtrk_index]))
+      {
+        return false;
+      }
+
+      ++mtrk_index;
+    }
+  }
+
+  return true;
+}
+
+static vector<uint8_t> concatenated{};
+static vector<MIDI_File> well_formed{};
+
+static MIDI_Element_Decoder::STATUS feed(MIDI_Stream_Decoder& dec, const uint8_t* data, size_t size)
+{
+  size_t pos = 0;
+
+  while (pos < size)
+  {
+    size_t count = 1 + (size_t)(rand() % 61);
+    count = (count < (size - pos)) ? count : (size - pos);
+
+    if (dec.decode(data + pos, count) == MIDI_Element_Decoder::STATUS::FAIL)
+    {
+      return MIDI_Element_Decoder::STATUS::FAIL;
+    }
+
+    pos += count;
+  }
+
+  return dec.finish();
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File_Decoder file_dec{};
+  MIDI_File expected{};
+  Recorder recorder{};
+  MIDI_Stream_Decoder dec(recorder);
+
+  bool decode_ok = (file_dec.decode(data, size, expected) == MIDI_Element_Decoder::STATUS::SUCCESS);
+
+  // the bytes after the last chunk of a file would start the next file of a stream
+  size = decode_ok ? file_dec.get_index() : size;
+
+  bool stream_ok = (feed(dec, data, size) == MIDI_Element_Decoder::STATUS::SUCCESS);
+
+  if (!decode_ok || !stream_ok)
+  {
+    return (decode_ok == stream_ok); // both must reject malformed input
+  }
+
+  bool match = recorder.order_ok && (recorder.files.size() == 1) && same_files(expected, recorder.files[0]);
+
+  concatenated.insert(concatenated.end(), data, data + size);
+  well_formed.push_back(std::move(expected));
+
+  return match;
+}
+
+static bool check_concatenated()
+{
+  // the well-formed files again, back to back in one stream
+  Recorder recorder{};
+  MIDI_Stream_Decoder dec(recorder);
+  bool match = (feed(dec, concatenated.data(), concatenated.size()) == MIDI_Element_Decoder::STATUS::SUCCESS) &&
+               recorder.order_ok && (recorder.files.size() == well_formed.size()) &&
+               (dec.get_file_count() == well_formed.size());
+
+  for (size_t i = 0; match && (i < well_formed.size()); ++i)
+  {
+    match = same_files(well_formed[i], recorder.files[i]);
+  }
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  srand(1);
+
+  return run_compare(argc, argv, compare_file, {{"concatenated", check_concatenated}});
+}
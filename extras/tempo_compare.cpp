@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Tempo.h"
+
+using namespace std;
+
+/*
+Checks `MIDI_Tempo_Map`. Every file given on the command line is decoded and the time of every event tick is compared with a plain walk over the
+tempo events, for single conversions and for sorted and unsorted batches, and
+`to_ticks` must invert `to_microseconds` up to rounding. A few hand-built files
+with known timings are checked as well: tempo changes in several tracks, changes
+at the same tick, SMPTE divisions and an invalid division.
+*/
+
+struct Tempo_Change
+{
+  uint64_t             tick{0};
+  uint32_t             tempo{0};
+};
+
+static void push_tempo(MTrk_Chunk& track, uint32_t dt, uint32_t tempo)
+{
+  MTrk_Event& event = track.emplace_back_event();
+  event.set_dt(dt);
+  event.push_byte(STATUS_BYTE::META);
+  event.push_byte(0x51);
+  event.push_byte(0x03);
+  event.push_byte((uint8_t)(tempo >> 16));
+  event.push_byte((uint8_t)(tempo >> 8));
+  event.push_byte((uint8_t)tempo);
+}
+
+static void push_note(MTrk_Chunk& track, uint32_t dt)
+{
+  MTrk_Event& event = track.emplace_back_event();
+  event.set_dt(dt);
+  event.push_byte(0x90);
+  event.push_byte(0x3C);
+  event.push_byte(0x40);
+}
+
+static bool check_built()
+{
+  MIDI_Tempo_Map map{};
+  bool match = true;
+
+  // 480 ticks per quarter note: 120 BPM, 240 BPM from tick 960, 60 BPM from tick 1440 set in another track
+  MIDI_File file{};
+  MTrk_Chunk& conductor = file.emplace_back_mtrk();
+  MTrk_Chunk& notes = file.emplace_back_mtrk();
+
+  push_tempo(conductor, 0, 500000);
+  push_tempo(conductor, 960, 250000);
+  push_note(notes, 1000);
+  push_tempo(notes, 440, 1000000);
+  file.get_hdr().set_fmt(1);
+  file.get_hdr().set_ntrks(2);
+  file.get_hdr().set_div(480);
+
+  match = match && map.build(file) && !map.is_smpte() && (map.get_segment_count() == 3);
+  match = match && (map.to_microseconds(480) == 500000) && (map.to_microseconds(960) == 1000000) &&
+          (map.to_microseconds(1440) == 1250000) && (map.to_microseconds(1920) == 2250000);
+  match = match && (map.to_ticks(1250000) == 1440) && (map.to_ticks(2250000) == 1920) && (map.to_ticks(1000001) == 960);
+  match = match && (map.get_tempo(959) == 500000) && (map.get_tempo(960) == 250000) && (map.get_tempo(5000) == 1000000);
+
+  // batches cross every segment
+  const uint64_t ticks[] = {0, 480, 960, 1000, 1440, 1920};
+  const uint64_t expected[] = {0, 500000, 1000000, 1020833, 1250000, 2250000};
+  const Channel_Event events[] = {{0, 0x90, 60, 64, 0}, {480, 0x80, 60, 0, 0}, {960, 0x90, 62, 64, 0},
+                                  {1000, 0x80, 62, 0, 0}, {1440, 0x90, 64, 64, 0}, {1920, 0x80, 64, 0, 0}};
+  uint64_t batch[6]{};
+  uint64_t event_batch[6]{};
+
+  map.to_microseconds(ticks, 6, batch);
+  map.to_microseconds(events, 6, event_batch);
+  match = match && equal(batch, batch + 6, expected) && equal(event_batch, event_batch + 6, expected);
+
+  // the later track wins a change at the same tick, and a change back to the same tempo adds no segment
+  push_tempo(notes, 0, 250000);
+  match = match && map.build(file) && (map.get_segment_count() == 2) && (map.to_microseconds(1920) == 1500000);
+
+  // SMPTE: 25 frames per second, 40 ticks per frame, tempo events ignored
+  file.get_hdr().set_div((uint16_t)((uint8_t)-25 << 8 | 40));
+  match = match && map.build(file) && map.is_smpte() && (map.to_microseconds(1000) == 1000000) &&
+          (map.to_ticks(1000000) == 1000);
+
+  // 29.97 frames per second, 4 ticks per frame
+  file.get_hdr().set_div((uint16_t)((uint8_t)-29 << 8 | 4));
+  match = match && map.build(file) && (map.to_microseconds(120) == 1001000) && (map.to_ticks(1001000) == 120);
+
+  // a single track of a format 2 file
+  file.get_hdr().set_div(96);
+  match = match && map.build(file.get_hdr(), notes) && (map.to_microseconds(1440) == 7500000);
+
+  // no time can be derived from these
+  file.get_hdr().set_div(0);
+  match = match && !map.build(file) && (map.to_microseconds(100) == 0) && (map.to_ticks(100) == 0);
+  file.get_hdr().set_div((uint16_t)((uint8_t)-24 << 8));
+  match = match && !map.build(file);
+
+  return match;
+}
+
+/*
+Reference conversion: walk the merged tempo changes from the start up to `tick`.
+*/
+static uint64_t walk_microseconds(const vector<Tempo_Change>& changes, uint32_t div, uint64_t tick)
+{
+  uint64_t scaled_us = 0;
+  uint64_t at = 0;
+  uint32_t tempo = MIDI_Tempo_Map::DEFAULT_TEMPO;
+
+  for (const Tempo_Change& change : changes)
+  {
+    if (change.tick > tick)
+    {
+      break;
+    }
+
+    scaled_us += (change.tick - at) * tempo;
+    at = change.tick;
+    tempo = change.tempo;
+  }
+
+  return (scaled_us + (tick - at) * tempo) / div;
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File file{};
+  MIDI_Tempo_Map map{};
+
+  if (!decode_file(data, size, file) || (file.get_hdr().get_div() & 0x8000))
+  {
+    return true; // nothing to compare
+  }
+
+  if (!map.build(file))
+  {
+    return (file.get_hdr().get_div() == 0);
+  }
+
+  /****************************************
+  Tempo events and event ticks of all tracks
+  ****************************************/
+  vector<Tempo_Change> changes{};
+  vector<uint64_t> ticks{};
+
+  for (size_t i = 0; i < file.get_hdr().get_ntrks(); ++i)
+  {
+    if (file.get_chunk(i).get_header() != CHUNK_HEADER::MTRK)
+    {
+      continue;
+    }
+
+    uint64_t tick = 0;
+
+    for (MTrk_Event& event : static_cast<MTrk_Chunk&>(file.get_chunk(i)))
+    {
+      tick += event.get_dt();
+      ticks.push_back(tick);
+
+      if ((event.get_status() == STATUS_BYTE::META) && (event.get_payload_size() == 6) && (event[1] == 0x51) &&
+          (event[2] == 0x03))
+      {
+        uint32_t tempo = ((uint32_t)event[3] << 16) | ((uint32_t)event[4] << 8) | event[5];
+
+        if (tempo != 0)
+        {
+          changes.push_back({tick, tempo});
+        }
+      }
+    }
+  }
+
+  stable_sort(changes.begin(), changes.end(), [](const Tempo_Change& a, const Tempo_Change& b){ return a.tick < b.tick; });
+
+  /****************************************
+  Single and batch conversions
+  ****************************************/
+  uint32_t div = file.get_hdr().get_div();
+  vector<uint64_t> batch{};
+  bool match = true;
+
+  sort(ticks.begin(), ticks.end());
+  ticks.push_back(ticks.empty() ? 0 : ticks.back() + 100000); // past the last event
+  batch.resize(ticks.size());
+  map.to_microseconds(ticks.data(), ticks.size(), batch.data());
+
+  for (size_t i = 0; match && (i < ticks.size()); ++i)
+  {
+    uint64_t expected = walk_microseconds(changes, div, ticks[i]);
+    uint64_t back = map.to_ticks(expected);
+
+    match = (map.to_microseconds(ticks[i]) == expected) && (batch[i] == expected) && (back <= ticks[i]) &&
+            (map.to_microseconds(back) <= expected) && (map.to_microseconds(back + 1) >= expected);
+  }
+
+  reverse(ticks.begin(), ticks.end());
+  map.to_microseconds(ticks.data(), ticks.size(), batch.data());
+
+  for (size_t i = 0; match && (i < ticks.size()); ++i)
+  {
+    match = (batch[i] == walk_microseconds(changes, div, ticks[i]));
+  }
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file, {{"built", check_built}});
+}
@@ -0,0 +1,149 @@
+#include <cstdint>
+#include <vector>
+
+#include "compare.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+#include "MIDI_View.h"
+
+using namespace std;
+
+/*
+Checks MIDI_File_View against MIDI_File_Decoder: every file given on the command
+line is decoded and viewed, and the header, chunk order and every event of every
+track must match. Both must reject the same files, among them the damaged
+copies made by `run_compare` and hand-built files whose MThd chunk is too short
+to hold its parameters.
+*/
+
+static bool compare_tracks(MTrk_Chunk& decoded, MTrk_View& view)
+{
+  size_t event_index = 0;
+  MTrk_Event_Iterator it = view.begin();
+
+  for (; it != view.end(); ++it, ++event_index)
+  {
+    if (event_index >= decoded.size())
+    {
+      return false;
+    }
+
+    MTrk_Event& event = decoded[event_index];
+
+    if ((it->get_dt() != event.get_dt()) ||
+        (it->get_status() != event.get_status()) ||
+        (it->get_payload_size() != event.get_payload_size()) ||
+        (it->get_size() != event.get_size()))
+    {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < event.get_payload_size(); ++i)
+    {
+      if ((*it)[i] != event[i])
+      {
+        return false;
+      }
+    }
+  }
+
+  return !it.failed() && (event_index == decoded.size()) && (view.size() == decoded.size());
+}
+
+static bool compare_file(const uint8_t* data, size_t size)
+{
+  MIDI_File decoded{};
+  MIDI_File_View view{};
+
+  bool decode_ok = decode_file(data, size, decoded);
+  bool view_ok = (view.index(data, size) == MIDI_Element_Decoder::STATUS::SUCCESS);
+
+  for (size_t i = 0; view_ok && (i < view.get_MTrk_count()); ++i)
+  {
+    view_ok = (view[i].check() == MIDI_Element_Decoder::STATUS::SUCCESS);
+  }
+
+  if (!decode_ok || !view_ok)
+  {
+    return (decode_ok == view_ok); // both must reject malformed input
+  }
+
+  MThd_Chunk& hdr = decoded.get_hdr();
+
+  if ((view.get_hdr().get_len() != hdr.get_len()) ||
+      (view.get_hdr().get_fmt() != hdr.get_fmt()) ||
+      (view.get_hdr().get_ntrks() != hdr.get_ntrks()) ||
+      (view.get_hdr().get_div() != hdr.get_div()))
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < view.get_hdr().get_extended_size(); ++i)
+  {
+    if (view.get_hdr()[i] != hdr[i])
+    {
+      return false;
+    }
+  }
+
+  // MTrk lengths are left out: a decoded track reports the length it would be encoded with
+  for (size_t i = 0; i < view.get_chunk_count(); ++i)
+  {
+    if ((view.get_chunk(i).get_header() != decoded.get_chunk(i).get_header()) ||
+        ((view.get_chunk(i).get_header() != CHUNK_HEADER::MTRK) && (view.get_chunk(i).get_len() != decoded.get_chunk(i).get_len())))
+    {
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < view.get_MTrk_count(); ++i)
+  {
+    if (!compare_tracks(decoded[i], view[i]))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool check_header_lengths()
+{
+  // an MThd shorter than 6 bytes is rejected by the view and by both decoder paths
+  bool match = true;
+
+  for (uint8_t mthd_len = 0; match && (mthd_len <= 8); ++mthd_len)
+  {
+    vector<uint8_t> data = {'M', 'T', 'h', 'd', 0, 0, 0, mthd_len};
+    const uint8_t params[] = {0x00, 0x00, 0x00, 0x01, 0x01, 0xE0, 0x00, 0x00};
+    const uint8_t track[] = {'M', 'T', 'r', 'k', 0, 0, 0, 4, 0x00, 0xFF, 0x2F, 0x00};
+
+    data.insert(data.end(), params, params + ((mthd_len < 6) ? 6 : mthd_len)); // fmt, ntrks and div follow anyway
+    data.insert(data.end(), track, track + sizeof(track));
+
+    MIDI_File bulk{};
+    MIDI_File bytewise{};
+    MIDI_File_Decoder bulk_dec{};
+    MIDI_File_Decoder byte_dec{};
+    MIDI_File_View view{};
+    MIDI_Element_Decoder::STATUS byte_status = MIDI_Element_Decoder::STATUS::STANDBY;
+
+    for (size_t i = 0; (i < data.size()) && (byte_status == MIDI_Element_Decoder::STATUS::STANDBY); ++i)
+    {
+      byte_status = byte_dec.decode_byte(data[i], bytewise);
+    }
+
+    bool expected = (mthd_len >= 6);
+
+    match = ((bulk_dec.decode(data.data(), data.size(), bulk) == MIDI_Element_Decoder::STATUS::SUCCESS) == expected) &&
+            ((byte_status == MIDI_Element_Decoder::STATUS::SUCCESS) == expected) &&
+            ((view.index(data.data(), data.size()) == MIDI_Element_Decoder::STATUS::SUCCESS) == expected);
+  }
+
+  return match;
+}
+
+int main(int argc, char **argv)
+{
+  return run_compare(argc, argv, compare_file, {{"header_lengths", check_header_lengths}});
+}
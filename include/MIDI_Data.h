@@ -2,10 +2,15 @@
 #define MIDI_DATA_H
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <list>
+#include <memory_resource>
 #include <vector>
 
+#define ENCODE_RUNNING_STATUS true
+
 enum        CHUNK_HEADER: uint32_t
 { 
     MTHD = 0x4D546864,
@@ -48,6 +53,99 @@ enum        STATUS_BYTE: uint8_t
     META             = 0xFF //RESET when sent to devices
 };
 
+/* ****************************************************************************
+*  Status byte table
+*  ************************************************************************* */
+enum class  STATUS_CLASS: uint8_t
+{
+    DATA,       // 0x00-0x7F: not a status byte, running status applies
+    CHANNEL,    // 0x80-0xEF
+    SYSEX,      // F0, F7
+    META,       // FF
+    SYSTEM      // F1-F6, F8-FE: not accepted in an MTrk chunk
+};
+
+struct      Status_Info
+{
+    STATUS_CLASS    type;
+    uint8_t         parameter_count; // data bytes after the status byte (meta and sysex carry a length instead)
+};
+
+constexpr Status_Info status_info(unsigned status)
+{
+    if (status < 0x80)
+    {
+        return {STATUS_CLASS::DATA, 0};
+    }
+    else if (status < 0xF0)
+    {
+        // one data byte for patch change and channel pressure, two for the rest
+        return {STATUS_CLASS::CHANNEL, (uint8_t)((((status & 0xF0) == 0xC0) || ((status & 0xF0) == 0xD0)) ? 1 : 2)};
+    }
+    else if ((status == STATUS_BYTE::SYSEX_F0) || (status == STATUS_BYTE::SYSEX_F7))
+    {
+        return {STATUS_CLASS::SYSEX, 0};
+    }
+    else if (status == STATUS_BYTE::META)
+    {
+        return {STATUS_CLASS::META, 0};
+    }
+    else if (status == STATUS_BYTE::SONG_POSITION)
+    {
+        return {STATUS_CLASS::SYSTEM, 2};
+    }
+    else if (status == STATUS_BYTE::SONG_SELECT)
+    {
+        return {STATUS_CLASS::SYSTEM, 1};
+    }
+
+    return {STATUS_CLASS::SYSTEM, 0};
+}
+
+constexpr std::array<Status_Info, 256> make_status_table()
+{
+    std::array<Status_Info, 256> table{};
+
+    for (unsigned status = 0; status < 256; ++status)
+    {
+        table[status] = status_info(status);
+    }
+
+    return table;
+}
+
+/*
+Classification of every status byte, so decoders and encoders look a byte up
+instead of comparing it against each status in turn.
+*/
+inline constexpr std::array<Status_Info, 256> STATUS_TABLE = make_status_table();
+
+/* ****************************************************************************
+*  Channel_Event
+*  ************************************************************************* */
+struct      Channel_Event
+{
+/*
+A channel message packed into 8 bytes: the absolute tick of the event (the sum
+of the delta times up to and including it, wrapping at 2^32), the status byte
+and up to two data bytes. `data2` is 0 for patch change and channel pressure.
+A track of these is what `MTrk_Chunk_Decoder::decode` fills when given a
+`std::vector<Channel_Event>` instead of an `MTrk_Chunk`.
+*/
+    uint32_t        tick;
+    uint8_t         status;
+    uint8_t         data1;
+    uint8_t         data2;
+    uint8_t         reserved; // padding, always 0
+
+    inline constexpr STATUS_CLASS get_status_class() const { return STATUS_TABLE[status].type; }
+    inline constexpr uint8_t get_command() const { return status & 0xF0; }
+    inline constexpr uint8_t get_channel() const { return status & 0x0F; }
+    inline constexpr uint16_t get_pitch_bend() const { return (uint16_t)(data1 | (data2 << 7)); }
+};
+
+static_assert(sizeof(Channel_Event) == 8, "Channel_Event must stay packed in 8 bytes");
+
 /* ****************************************************************************
 *  MIDI_Data
 **************************************************************************** */
@@ -69,30 +167,193 @@ protected:
 *  ************************************************************************* */
 class Varlen :                              public MIDI_Element
 {
+/*
+The static functions are the VLQ kernels shared by the decoders, encoders and
+views. A VLQ is at most 4 bytes (28 bits) long; larger values are cut to their
+low 28 bits when encoded, as by `Varlen_Encoder`.
+
+`encode` always stores 4 bytes at `out` and returns how many of them belong to
+the VLQ, so it can write straight into a buffer with room to spare. `decode`
+returns the number of bytes read, or 0 when the VLQ runs past `end` or is longer
+than 4 bytes.
+*/
 protected:
                     uint32_t                payload{0};
+
+    static          int                     leading_zeros(uint32_t word);
 public:
     inline          void                    set_data(uint32_t new_payload){ payload = new_payload; }
     // void set_data(uint8_t, uint8_t, uint8_t, uint8_t);
     inline          uint32_t                get_data(){ return payload; };
     static          int                     byte_count(uint32_t vlq);
-                    int                     byte_count();
+    inline          int                     byte_count(){ return byte_count(payload); }
+    static          int                     encode(uint32_t vlq, uint8_t* out);
+    static          int                     decode(const uint8_t* p, const uint8_t* end, uint32_t& vlq);
 };
 
+inline int Varlen::leading_zeros(uint32_t word)
+{
+    // `word` is never 0 here
+#if defined(__GNUC__)
+    return __builtin_clz(word);
+#else
+    int count = 0;
+
+    while (!(word & 0x80000000))
+    {
+        word <<= 1;
+        ++count;
+    }
+
+    return count;
+#endif
+}
+
+inline int Varlen::byte_count(uint32_t vlq)
+{
+    // 7 bits per byte, at most 4 bytes
+    int count = (32 - leading_zeros(vlq | 1) + 6) / 7;
+
+    return count - (count > 4);
+}
+
+inline int Varlen::encode(uint32_t vlq, uint8_t* out)
+{
+    // one 7-bit group per byte, bit 7 set on all but the last byte
+    int count = byte_count(vlq);
+    uint32_t groups = (vlq & 0x7F) | ((vlq << 1) & 0x7F00) | ((vlq << 2) & 0x7F0000) | ((vlq << 3) & 0x7F000000);
+
+    groups = (groups | 0x80808000) << (8 * (4 - count));
+
+    out[0] = (uint8_t)(groups >> 24);
+    out[1] = (uint8_t)(groups >> 16);
+    out[2] = (uint8_t)(groups >> 8);
+    out[3] = (uint8_t)(groups);
+
+    return count;
+}
+
+inline int Varlen::decode(const uint8_t* p, const uint8_t* end, uint32_t& vlq)
+{
+    if ((end - p) >= 4)
+    {
+        // the VLQ ends at the first byte with bit 7 clear
+        uint32_t word = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+        uint32_t last = ~word & 0x80808080;
+
+        if (last == 0)
+        {
+            return 0;
+        }
+
+        int count = (leading_zeros(last) >> 3) + 1;
+
+        word >>= 8 * (4 - count);
+        vlq = (word & 0x7F) | ((word >> 1) & 0x3F80) | ((word >> 2) & 0x1FC000) | ((word >> 3) & 0xFE00000);
+
+        return count;
+    }
+
+    // fewer than 4 bytes left in the buffer
+    uint32_t value = 0;
+
+    for (int count = 0; count < (end - p); ++count)
+    {
+        value = (value << 7) | (p[count] & 0b01111111);
+
+        if (!(p[count] & 0b10000000))
+        {
+            vlq = value;
+            return count + 1;
+        }
+    }
+
+    return 0;
+}
+
 /* ****************************************************************************
 *  MTrk_Event
 *  ************************************************************************* */
+class MTrk_Chunk;
+
 class MTrk_Event :                          public MIDI_Element
 {
+/*
+An entry of an `MTrk_Chunk` event table: delta time, status byte and the
+location of the payload bytes. Payloads of up to `INLINE_CAPACITY` bytes (every
+channel message and most meta events) are stored in the event itself, so the
+event stays 32 bytes long and two of them fit in a cache line. Longer payloads
+of events owned by a chunk are kept in the chunk's shared byte arena (`offset`,
+`length`), so a track costs no allocation per event.
+
+A longer payload of an event that is not owned by a chunk (default constructed,
+or copied or moved out of one) is kept in its own heap buffer. Copying an event,
+or moving an event of a chunk, always produces such a detached event and leaves
+the chunk as it was; only a detached event gives up its payload when moved.
+Payloads change hands between events of a chunk only inside the chunk, when
+its table shifts or grows and in the rvalue `insert_event`.
+
+`set_dt`, `push_byte(s)` and copy and move assignment on an event of a chunk
+keep the chunk length up to date.
+
+The channel message getters read the status and data bytes without a copy or
+a status check: `get_channel` and `get_command` split the status byte, and
+`get_data1`, `get_data2` and `get_pitch_bend` (0 to 16383, centred on 8192)
+return 0 for bytes the event does not have. They are only meaningful when
+`get_status_class()` is `STATUS_CLASS::CHANNEL`.
+*/
+    friend class MTrk_Chunk;
+public:
+    static const    uint32_t                INLINE_CAPACITY{14};
 protected:
+    enum class      STORAGE :               uint8_t
+    {
+                                            INLINE,
+                                            ARENA,
+                                            HEAP
+    };
+
+                    MTrk_Chunk*             owner{nullptr};
                     Varlen                  dt{};
-                    std::vector<uint8_t>    bytes{};
+                    uint32_t                length{0};
+                    uint8_t                 local[INLINE_CAPACITY]{}; // payload, or the arena offset / heap buffer
+                    uint8_t                 status{0};
+                    STORAGE                 storage{STORAGE::INLINE};
+
+    inline          uint32_t                get_offset(){ uint32_t offset; std::memcpy(&offset, local, sizeof(offset)); return offset; }
+    inline          void                    set_offset(uint32_t offset){ std::memcpy(local, &offset, sizeof(offset)); }
+    inline          std::vector<uint8_t>*   get_heap(){ std::vector<uint8_t>* heap; std::memcpy(&heap, local, sizeof(heap)); return heap; }
+    inline          void                    set_heap(std::vector<uint8_t>* heap){ std::memcpy(local, &heap, sizeof(heap)); }
+    inline          uint8_t                 data_byte(uint32_t index){ return (index >= length) ? 0 : (storage == STORAGE::INLINE) ? local[index] : get_payload()[index]; }
+
+                    void                    release();
+                    void                    spill();
+                    void                    store(const uint8_t* new_bytes, size_t count);
+                    void                    take(MTrk_Event& other);
+                    void                    relocate(MTrk_Event& other);
 public:
+                                            MTrk_Event(){}
+                                            MTrk_Event(const MTrk_Event& other);
+                                            MTrk_Event(MTrk_Event&& other);
+                                           ~MTrk_Event();
+                    MTrk_Event&             operator=(const MTrk_Event& other);
+                    MTrk_Event&             operator=(MTrk_Event&& other);
+
+                    void                    clear(); // delta time 0, no payload; a detached event keeps its buffer
                     void                    set_dt(uint32_t new_dt);
     inline          uint32_t                get_dt() { return dt.get_data(); }
+    inline          uint8_t                 get_status() { return status; }
+    inline          STATUS_CLASS            get_status_class() { return STATUS_TABLE[status].type; }
+    inline          uint8_t                 get_command() { return status & 0xF0; }
+    inline          uint8_t                 get_channel() { return status & 0x0F; }
+    inline          uint8_t                 get_data1() { return data_byte(1); }
+    inline          uint8_t                 get_data2() { return data_byte(2); }
+    inline          uint16_t                get_pitch_bend() { return (uint16_t)(data_byte(1) | (data_byte(2) << 7)); }
                     uint32_t                get_size();
-    inline          uint32_t                get_payload_size() { return static_cast<uint32_t>(bytes.size()); }
+    inline          uint32_t                get_payload_size() { return length; }
+                    const uint8_t*          get_payload();
                     void                    push_byte(uint8_t new_byte);
+                    void                    push_bytes(const uint8_t* new_bytes, size_t count);
                     uint8_t                 operator[](size_t index);
 };
 
@@ -123,9 +384,13 @@ protected:
                     uint16_t                fmt{0};
                     uint16_t                ntrks{0};
                     uint16_t                div{0};
-                    std::vector<uint8_t>    extended_content{};
+                    std::pmr::vector<uint8_t> extended_content{};
 public:
+    using           allocator_type =        std::pmr::polymorphic_allocator<uint8_t>;
+
                                             MThd_Chunk();
+    explicit                                MThd_Chunk(const allocator_type& alloc);
+                                            MThd_Chunk(const MThd_Chunk& other, const allocator_type& alloc);
 
                     uint16_t                get_fmt();
                     uint16_t                get_ntrks();
@@ -135,33 +400,128 @@ public:
                     void                    set_ntrks(uint16_t new_ntrks);
                     void                    set_div(uint16_t new_div);
                     void                    push_byte(uint8_t);
+                    void                    push_bytes(const uint8_t* new_bytes, size_t count);
+                    void                    clear(); // as constructed, keeping the capacity of the extended content
 
+    inline          size_t                  get_extended_size(){ return extended_content.size(); }
+    inline          const uint8_t*          get_extended_content(){ return extended_content.data(); }
+    inline          size_t                  get_extended_capacity(){ return extended_content.capacity(); }
                     uint8_t&                operator[](size_t index);
 };
 
+/* ****************************************************************************
+*  MTrk_Checkpoint
+*  ************************************************************************* */
+struct MTrk_Checkpoint
+{
+/*
+Where event `event` of an `MTrk_Chunk` starts: its absolute tick, its offset in
+the chunk body as `MTrk_Encoder` writes it, and the running status in effect
+before it (0 when its status byte has to be written). Together they let a
+reader of the encoded track start at the event instead of at the first one.
+*/
+                    size_t                  event{0};
+                    uint64_t                tick{0};
+                    uint32_t                offset{0};
+                    uint8_t                 running_status{0};
+};
+
 /* ****************************************************************************
 *  MTrk_Chunk
 *  ************************************************************************* */
 class MTrk_Chunk :                          public MIDI_Chunk
 {
+/*
+Events are stored contiguously in `events`, a table of delta time, status, offset
+and length. Payload bytes of all events are appended to one `arena` per track.
+
+Bytes left behind in the arena by erased or relocated events are counted in
+`garbage` and dropped by `compact()`, which is also triggered automatically once
+more than half of the arena is unused.
+
+Because events live in a vector, references returned by the functions below are
+invalidated when events are added to or removed from the chunk.
+
+`len` is kept equal to the number of bytes `MTrk_Encoder` writes for the events
+(running status included) by adjusting it on every change to the table or to an
+event, instead of summing all events again.
+
+The table and the arena are allocated from the chunk's memory resource, the
+default one unless an allocator is given (see `MIDI_File`). A moved-from chunk
+is left empty, with a length of 0 and no index. Moving between chunks with
+different resources copies the table and the arena, so that move assignment
+may throw `std::bad_alloc`.
+
+`seek`, `get_tick` and `get_checkpoint` answer from a time index that is only
+built when one of them is first called: the absolute tick of every event, and a
+`MTrk_Checkpoint` every `CHECKPOINT_INTERVAL` events. Changing, adding or
+removing event `i` only marks the index as stale from `i` on; the next call
+brings it up to date from there, so edits near the end of a long track are cheap
+to follow. `drop_index()` frees it.
+*/
+    friend class MTrk_Event;
 protected:
-                    std::list<MTrk_Event>   events{};
-                    uint32_t                update_chunk_size();
+                    std::pmr::vector<MTrk_Event> events{};
+                    std::pmr::vector<uint8_t> arena{};
+                    size_t                  garbage{0};
+                    std::pmr::vector<uint64_t> ticks{};     // absolute tick of each indexed event
+                    std::pmr::vector<MTrk_Checkpoint> checkpoints{};
+                    size_t                  indexed{0};     // events at the front whose index entries are current
+
+                    size_t                  index_of(MTrk_Event& event);
+                    uint32_t                event_size(size_t index);
+                    uint32_t                local_size(size_t index);
+                    void                    append(MTrk_Event& event, const uint8_t* new_bytes, size_t count);
+                    void                    copy_events(const MTrk_Chunk& other);
+                    void                    take_events(MTrk_Chunk& other);
+                    void                    make_room(size_t event_count);
+                    void                    rebind();
+    inline          void                    invalidate(size_t index){ if (index < indexed) { indexed = index; } }
+                    void                    update_index();
 public:
+    static const    size_t                  CHECKPOINT_INTERVAL{64};
+
+    using           allocator_type =        std::pmr::polymorphic_allocator<uint8_t>;
+
                                             MTrk_Chunk();
+    explicit                                MTrk_Chunk(const allocator_type& alloc);
+                                            MTrk_Chunk(const MTrk_Chunk& other);
+                                            MTrk_Chunk(const MTrk_Chunk& other, const allocator_type& alloc);
+                                            MTrk_Chunk(MTrk_Chunk&& other) noexcept;
+                                            MTrk_Chunk(MTrk_Chunk&& other, const allocator_type& alloc);
+                    MTrk_Chunk&             operator=(const MTrk_Chunk& other);
+                    MTrk_Chunk&             operator=(MTrk_Chunk&& other);
 
-                    // TODO: Update chunk size
                     MTrk_Event&             emplace_back_event();
                     MTrk_Event&             emplace_event(size_t index);
-                    MTrk_Event&             insert_event(size_t index, MTrk_Event& event);
+                    MTrk_Event&             insert_event(size_t index, const MTrk_Event& event);
+
+                    /*
+                    Moves `event` to `index` without copying its payload when it is detached
+                    or already in this chunk (e.g. `insert_event(j, std::move(chunk[i]))`,
+                    then `erase` the emptied slot). `event` is left with no payload.
+                    */
+                    MTrk_Event&             insert_event(size_t index, MTrk_Event&& event);
                     void                    erase(size_t index);
 
+                    void                    reserve(size_t event_count, size_t byte_count);
+                    void                    compact();
+                    void                    clear(); // no events, keeping the capacity of the table and the arena
+
                     MTrk_Event&             back();
                     MTrk_Event&             front();
             inline  size_t                  size(){ return events.size(); }
-                    std::list<MTrk_Event>::iterator begin();
-                    std::list<MTrk_Event>::iterator end();
+    inline          size_t                  get_capacity(){ return events.capacity(); }
+    inline          size_t                  get_arena_capacity(){ return arena.capacity(); }
+
+                    size_t                  seek(uint64_t tick); // first event at or after `tick`, or `size()`
+                    uint64_t                get_tick(size_t index); // tick of the last event for `index >= size()`, 0 when empty
+                    MTrk_Checkpoint         get_checkpoint(size_t index); // the last checkpoint at or before event `index`, or the last one
+                    void                    drop_index();
+                    std::pmr::vector<MTrk_Event>::iterator begin();
+                    std::pmr::vector<MTrk_Event>::iterator end();
                     MTrk_Event&             operator[](size_t index);
+    inline          allocator_type          get_allocator(){ return arena.get_allocator(); }
 };
 
 /* ****************************************************************************
@@ -170,12 +530,22 @@ public:
 class UNkn_Chunk :                          public MIDI_Chunk
 {
 protected:
-                    std::vector<uint8_t>    bytes{};
+                    std::pmr::vector<uint8_t> bytes{};
 public:
+    using           allocator_type =        std::pmr::polymorphic_allocator<uint8_t>;
+
                                             UNkn_Chunk();
+    explicit                                UNkn_Chunk(const allocator_type& alloc);
+                                            UNkn_Chunk(const UNkn_Chunk& other, const allocator_type& alloc);
+                                            UNkn_Chunk(UNkn_Chunk&& other, const allocator_type& alloc);
 
-                    void                    set_len(uint32_t new_len);
+                    void                    set_len(uint32_t new_len); // also drops the bytes, keeping their capacity
+                    void                    clear();
                     void                    push_byte(uint8_t next_byte);
+                    void                    push_bytes(const uint8_t* next_bytes, size_t count);
+    inline          size_t                  get_byte_count(){ return bytes.size(); }
+    inline          const uint8_t*          get_bytes(){ return bytes.data(); }
+    inline          size_t                  get_capacity(){ return bytes.capacity(); }
                     uint8_t                 operator[](size_t index);
 };
 
@@ -195,14 +565,44 @@ Adding chunks to this container is a necessary side effect any time a new MTrk
 or UNkn chunk is emplaced. The containers are therefore `protected` to ensure
 the proper side effects take place, while references to elements in the containers
 are still exposed through getters.
+
+A file constructed with an allocator, e.g. `MIDI_File file(&resource)` with a
+`std::pmr::monotonic_buffer_resource resource`, takes every container, chunk,
+event table and payload arena from that resource, so a decoded file can be
+discarded by releasing the resource. Only payloads of events copied out of the
+file are allocated elsewhere. The resource must outlive the file, and must be
+thread-safe if the file is filled by `MIDI_File_Decoder::decode_parallel`.
+
+`clear()` empties a file so it can receive the next one without allocating
+again: the chunks are emptied and set aside with their event tables and arenas,
+and the emplace and insert functions take them back before allocating new ones.
+
+Moving a file, or moving chunks into it with the rvalue `insert_mtrk` and
+`insert_unkn`, hands over the event tables and arenas as they are, provided
+both sides use the same memory resource. Otherwise the bytes are copied.
 */
 
 protected:
                     MThd_Chunk              hdr{};
-                    std::vector<MIDI_Chunk*>  ordered_chunks{}; // pointers in vector cannot be const because vectors copy
-                    std::list<MTrk_Chunk>   mtrk_chunks{}; // could be vectors but pushing back
-                    std::list<UNkn_Chunk>   unkn_chunks{}; // can cause moves and pointers in `ordered_chunks` would need to be reset.
+                    std::pmr::vector<MIDI_Chunk*> ordered_chunks{}; // pointers in vector cannot be const because vectors copy
+                    std::pmr::list<MTrk_Chunk> mtrk_chunks{}; // could be vectors but pushing back
+                    std::pmr::list<UNkn_Chunk> unkn_chunks{}; // can cause moves and pointers in `ordered_chunks` would need to be reset.
+                    std::pmr::list<MTrk_Chunk> spare_mtrk_chunks{}; // cleared chunks, reused before allocating
+                    std::pmr::list<UNkn_Chunk> spare_unkn_chunks{};
+
+                    std::pmr::list<MTrk_Chunk>::iterator new_mtrk(std::pmr::list<MTrk_Chunk>::iterator position);
+                    std::pmr::list<UNkn_Chunk>::iterator new_unkn(std::pmr::list<UNkn_Chunk>::iterator position);
+                    void                    copy_chunks(const MIDI_File& other);
 public:
+    using           allocator_type =        std::pmr::polymorphic_allocator<uint8_t>;
+
+                                            MIDI_File(){}
+    explicit                                MIDI_File(const allocator_type& alloc);
+                                            MIDI_File(const MIDI_File& other);
+                                            MIDI_File(MIDI_File&& other) = default;
+                    MIDI_File&              operator=(const MIDI_File& other);
+                    MIDI_File&              operator=(MIDI_File&& other);
+
                     /*
                     Functions for inserting & removing tracks will not automatically update header
                     `MIDI_Decoder` utilizes these functions to create a MIDI file.
@@ -212,17 +612,21 @@ public:
                     MTrk_Chunk&             emplace_back_mtrk();
                     MTrk_Chunk&             emplace_mtrk(size_t absolute_index);
                     MTrk_Chunk&             insert_mtrk(size_t absolute_index, const MTrk_Chunk& new_chunk);
+                    MTrk_Chunk&             insert_mtrk(size_t absolute_index, MTrk_Chunk&& new_chunk);
                     
                     UNkn_Chunk&             emplace_back_unkn();
                     UNkn_Chunk&             emplace_unkn(size_t absolute_index);
                     UNkn_Chunk&             insert_unkn(size_t absolute_index, const UNkn_Chunk& new_chunk);
+                    UNkn_Chunk&             insert_unkn(size_t absolute_index, UNkn_Chunk&& new_chunk);
                     
                     void                    erase(size_t absolute_index);
+                    void                    clear();
                     
                     MThd_Chunk&             get_hdr();
                     MIDI_Chunk&             get_chunk(size_t index);
                     MTrk_Chunk&             get_MTrk(size_t index);
                     MTrk_Chunk&             operator[](size_t index);
+    inline          allocator_type          get_allocator(){ return ordered_chunks.get_allocator(); }
 };
 
 #endif
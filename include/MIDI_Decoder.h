@@ -1,8 +1,17 @@
 #ifndef MIDI_DECODER_H
 #define MIDI_DECODER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
 #include "Noncopyable.h"
 #include "MIDI_Data.h"
+#include "MIDI_Stats.h"
 
 /* ****************************************************************************
 *  MIDI_Element
@@ -23,6 +32,7 @@ protected:
 public:
     virtual         void                    clear() = 0; // implemented in cpp file AND descendents must still implement
     virtual         STATUS                  decode_byte(uint8_t, MIDI_Element* data) = 0;
+            inline  size_t                  get_index(){ return index; }
 };
 
 
@@ -43,7 +53,8 @@ protected:
                     uint32_t                varlen{};
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element*);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte);
             inline  uint32_t                get(){ return varlen; }
 };
 
@@ -65,7 +76,8 @@ protected:
                     uint32_t                len{0};
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte);
             inline  uint32_t                get_len(){ return len; }
 };
 
@@ -90,8 +102,10 @@ protected:
                 
                     STATUS                  set_type(uint8_t new_running_status);
 public:
+    static          STATUS                  get_parameter_count(uint8_t status, uint8_t& count);
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MTrk_Event& product);
 };
 
 
@@ -118,7 +132,9 @@ protected:
                     Varlen_Decoder          len_decoder{};
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MTrk_Event& product);
+            inline  size_t                  get_len_size(){ return len_decoder.get_index(); } // bytes of the length
 };
 
 
@@ -144,7 +160,9 @@ protected:
                     Varlen_Decoder          varlen_decoder{};
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MTrk_Event& product);
+            inline  size_t                  get_len_size(){ return varlen_decoder.get_index(); } // bytes of the length
 };
 
 
@@ -174,9 +192,16 @@ protected:
                     MIDI_Event_Decoder      midi_decoder{};
                     Meta_Event_Decoder      meta_decoder{};
                     Sysex_Event_Decoder     sysex_decoder{};
+#ifdef MIDI_STATS
+                    MIDI_Stats*             stats{nullptr};
+#endif
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MTrk_Chunk& product);
+#ifdef MIDI_STATS
+            inline  void                    set_stats(MIDI_Stats* new_stats){ stats = new_stats; }
+#endif
 };
 
 
@@ -199,7 +224,8 @@ protected:
 
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte);
                     CHUNK_TYPE              get_type();
                     uint32_t                get_header();
 };
@@ -224,7 +250,9 @@ protected:
                     STATUS                  current_status{STATUS::STANDBY};
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, UNkn_Chunk& product);
+                    STATUS                  decode(const uint8_t* body, uint32_t len, UNkn_Chunk& product);
 };
 
 
@@ -248,10 +276,44 @@ protected:
                     STATE                   current_state{STATE::CHUNK_LEN};
                     STATUS                  len_status{STATUS::STANDBY};
                     STATUS                  current_status{STATUS::STANDBY};
+#ifdef MIDI_STATS
+                    MIDI_Stats*             stats{nullptr};
+#endif
 
 public:
+    /*
+    The bulk `decode`s reserve room for one event per 3 bytes of the body (a
+    channel message with its delta time), but for no more than this many events:
+    a body of long sysex or meta payloads would otherwise reserve a table many
+    times its own size. Past the limit the table grows geometrically.
+    */
+    static const    size_t                  MAX_RESERVED_EVENTS{65536};
+
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MTrk_Chunk& product);
+                    STATUS                  decode(const uint8_t* body, uint32_t len, MTrk_Chunk& product);
+
+                    /*
+                    Same, with the number of events and of arena bytes of the body known
+                    beforehand, as `MIDI_Scanner::validate` reports them in the chunk's
+                    `MIDI_Chunk_Span` (`event_count`, `byte_count`): the table and the arena
+                    are reserved once at their final size instead of from a guess.
+                    */
+                    STATUS                  decode(const uint8_t* body, uint32_t len, MTrk_Chunk& product,
+                                                   size_t event_count, size_t byte_count);
+
+                    /*
+                    Checks a complete chunk body with the same rules but keeps only its channel
+                    messages, appended to `product` as `Channel_Event`s with absolute ticks.
+                    Meta and sysex events still count towards the ticks. No `MTrk_Event` is
+                    built, so an analysis that only needs notes and controllers reads each
+                    event once.
+                    */
+                    STATUS                  decode(const uint8_t* body, uint32_t len, std::vector<Channel_Event>& product);
+#ifdef MIDI_STATS
+            inline  void                    set_stats(MIDI_Stats* new_stats){ stats = new_stats; event_decoder.set_stats(new_stats); }
+#endif
 };
 
 
@@ -279,8 +341,8 @@ public:
                                             DIV
     };
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data,
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MThd_Chunk& product,
                                                         MTHD_PARAM cur_param);
             inline  uint16_t                get(){ return param; }
 };
@@ -310,7 +372,9 @@ protected:
                     size_t                  extended_last{};
 public:
                     void                    clear();
-                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MThd_Chunk& product);
+                    STATUS                  decode(const uint8_t* body, uint32_t len, MThd_Chunk& product);
 };
 
 
@@ -341,9 +405,136 @@ protected:
                     uint32_t                expected_tracks{0};
                     size_t                  track_index{0};
 
+                    STATUS                  next_chunk();
+#ifdef MIDI_STATS
+                    MIDI_Stats              stats{};
+                    size_t                  seen_capacity{0};       // of the chunk being decoded byte by byte
+                    size_t                  seen_arena_capacity{0};
+
+                    void                    begin_chunk_stats(MIDI_File& product, uint32_t header);
+                    void                    count_chunk_bytes(uint64_t bytes);
+                    void                    count_growth(MIDI_File& product);
+#endif
+public:
+                    void                    clear();
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data) final;
+                    STATUS                  decode_byte(uint8_t next_byte, MIDI_File& product);
+
+                    /*
+                    Bulk entry point: every chunk that lies entirely inside `data` is decoded
+                    in a single pass over the buffer. Bytes of a chunk cut off by the end of
+                    `data` are handed to `decode_byte` so a later call can pick up where this
+                    one stopped. Returns STANDBY while more bytes are expected, SUCCESS once
+                    the last chunk announced by the MThd chunk has been read (trailing bytes
+                    are not consumed) and FAIL on malformed input.
+                    */
+                    STATUS                  decode(const uint8_t* data, size_t len, MIDI_File& product);
+#if __cplusplus >= 202002L
+            inline  STATUS                  decode(std::span<const uint8_t> data, MIDI_File& product){ return decode(data.data(), data.size(), product); }
+#endif
+
+                    /*
+                    Same result as `decode` for a buffer holding a whole file: chunk headers
+                    are scanned first, the chunks are created in file order and the MTrk
+                    bodies are then decoded concurrently by up to `thread_count` threads
+                    (0 picks the hardware concurrency). An incomplete buffer, or a decoder
+                    that has already been fed bytes, falls back to `decode`. When FAIL is
+                    returned the tracks of `product` are left partially decoded.
+                    */
+                    STATUS                  decode_parallel(const uint8_t* data, size_t len, MIDI_File& product,
+                                                            unsigned thread_count = 0);
+
+#ifdef MIDI_STATS
+                    /*
+                    Counters for the input since the last `clear()`, whichever entry
+                    points were used (see `MIDI_Stats`).
+                    */
+    inline          const MIDI_Stats&       get_stats(){ return stats; }
+#endif
+};
+
+
+/* ****************************************************************************
+*  MIDI_Stream_Handler
+*  ************************************************************************* */
+class MIDI_Stream_Handler
+{
+/*
+Callbacks of a `MIDI_Stream_Decoder`. The references passed in are only valid
+during the call. Every callback does nothing unless overridden.
+*/
 public:
+    virtual                                ~MIDI_Stream_Handler(){}
+
+    virtual         void                    on_header(MThd_Chunk& hdr){}
+    virtual         void                    on_track_begin(size_t track_index, uint32_t len){}
+    virtual         void                    on_event(MTrk_Event& event){}
+    virtual         void                    on_track_end(size_t track_index){}
+    virtual         void                    on_unknown_chunk(uint32_t header, uint32_t len){}
+};
+
+
+/* ****************************************************************************
+*  MIDI_Stream
+*  ************************************************************************* */
+class MIDI_Stream_Decoder:                  public MIDI_Element_Decoder
+{
+/*
+Push-style decoder: input arrives in blocks of any size and the file is reported
+through a `MIDI_Stream_Handler` instead of being stored in a `MIDI_File`. Each
+event is decoded into one reused `MTrk_Event`, so the memory kept between blocks
+does not depend on the length of the input, only on the largest single event.
+
+Files may be concatenated: after the last chunk announced by an MThd chunk the
+next chunk must be the MThd chunk of the following file. Unknown chunks are
+skipped without being buffered. `track_index` counts the MTrk chunks of the
+current file.
+*/
+protected:
+    enum class      STATE
+    {
+                                            CHUNK_HEAD,
+                                            MTHD,
+                                            DT,
+                                            EVENT_TYPE,
+                                            META_TYPE,
+                                            LEN,
+                                            PAYLOAD,
+                                            PARAMETERS,
+                                            SKIP,
+                                            FAIL
+    };
+
+                    MIDI_Stream_Handler&    handler;
+                    STATE                   current_state{STATE::CHUNK_HEAD};
+
+                    uint8_t                 head[8]{};
+                    size_t                  head_used{0};
+                    uint32_t                chunk_remaining{0};
+                    bool                    in_file{false};
+                    uint32_t                expected_chunks{0};
+                    uint32_t                chunk_count{0};
+                    size_t                  track_index{0};
+                    size_t                  file_count{0};
+
+                    MThd_Chunk              hdr{};
+                    MTrk_Event              event{};
+                    uint8_t                 running_status{0};
+                    uint32_t                varlen{0};
+                    uint32_t                varlen_bytes{0};
+                    uint32_t                remaining{0}; // payload or parameter bytes left in the event
+
+                    STATUS                  fail();
+                    STATUS                  next_chunk();
+                    STATUS                  end_event();
+public:
+                                            MIDI_Stream_Decoder(MIDI_Stream_Handler& new_handler): handler{new_handler}{}
+
                     void                    clear();
                     STATUS                  decode_byte(uint8_t next_byte, MIDI_Element* data);
+                    STATUS                  decode(const uint8_t* data, size_t len);
+                    STATUS                  finish(); // SUCCESS if the input ended after a complete file
+    inline          size_t                  get_file_count(){ return file_count; }
 };
 
 #endif
@@ -1,14 +1,15 @@
 #ifndef MIDI_ENCODER_H
 #define MIDI_ENCODER_H
 
+#include <cstddef>
 #include <cstdint>
 #include <list>
 #include <vector>
 
 #include "Noncopyable.h"
 #include "MIDI_Data.h"
-
-#define ENCODE_RUNNING_STATUS true
+#include "MIDI_Sink.h"
+#include "MIDI_Stats.h"
 
 /* ****************************************************************************
 *  MIDI_Element_Encoder
@@ -47,6 +48,8 @@ protected:
     };
 
                     STATE                   current_state{STATE::READ};
+                    uint8_t                 bytes[4]{};
+                    int                     count{0};
 public:
                     void                    clear();
                     STATUS                  encode_byte(uint8_t& product);
@@ -153,17 +156,25 @@ protected:
                     MTrk_Chunk*             src_chunk{};
                     STATE                   current_state{STATE::HEADER};
                     STATUS                  current_status{STATUS::STANDBY};
-                    size_t                  event_index{};
+                    std::pmr::vector<MTrk_Event>::iterator event_it{}; // next event to encode
                     uint8_t                 running_status{0};
 
                     Meta_Message_Encoder    meta_encoder{};
                     MIDI_Message_Encoder    midi_encoder{};
                     Sysex_Message_Encoder   sysex_encoder{};
+#ifdef MIDI_STATS
+                    MIDI_Stats*             stats{nullptr};
+#endif
 
 public:
                     void                    clear();
                     STATUS                  encode_byte(uint8_t& product);
                     STATUS                  set_data(MIDI_Element* data);
+                    STATUS                  encode(MTrk_Chunk& chunk, uint8_t* out, size_t size);
+                    STATUS                  encode(MTrk_Chunk& chunk, MIDI_Sink& sink);
+#ifdef MIDI_STATS
+            inline  void                    set_stats(MIDI_Stats* new_stats){ stats = new_stats; }
+#endif
 };
 
 
@@ -188,6 +199,8 @@ public:
                     void                    clear();
                     STATUS                  encode_byte(uint8_t& product);
                     STATUS                  set_data(MIDI_Element* data);
+                    STATUS                  encode(UNkn_Chunk& chunk, uint8_t* out, size_t size);
+                    STATUS                  encode(UNkn_Chunk& chunk, MIDI_Sink& sink);
 };
 
 
@@ -212,6 +225,8 @@ public:
                     void                    clear();
                     STATUS                  encode_byte(uint8_t& product);
                     STATUS                  set_data(MIDI_Element* data);
+                    STATUS                  encode(MThd_Chunk& chunk, uint8_t* out, size_t size);
+                    STATUS                  encode(MThd_Chunk& chunk, MIDI_Sink& sink);
 };
 
 
@@ -239,10 +254,51 @@ protected:
                     MThd_Encoder            mthd_encoder{};
                     MTrk_Encoder            mtrk_encoder{};
                     UNkn_Encoder            unkn_encoder{};
+#ifdef MIDI_STATS
+                    MIDI_Stats              stats{};
+
+                    void                    begin_chunk_stats(MIDI_Chunk& chunk, uint64_t bytes);
+#endif
 public:
                     void                    clear();
                     STATUS                  encode_byte(uint8_t& product);
                     STATUS                  set_data(MIDI_Element* data);
+
+                    /*
+                    Bulk entry points for the file given to `set_data`. The output size is
+                    known up front (8 header bytes + `get_len()` per chunk) and each chunk is
+                    written with whole runs of bytes instead of one `encode_byte` call per
+                    byte. `encode_to(out, cap)` fails without writing if `cap` is smaller
+                    than `get_encoded_size()`; the vector overload resizes `product` to the
+                    exact size. FAIL is also returned when a chunk's content does not add up
+                    to its `get_len()`.
+                    */
+                    size_t                  get_encoded_size();
+                    STATUS                  encode_to(std::vector<uint8_t>& product);
+                    STATUS                  encode_to(uint8_t* out, size_t cap);
+
+                    /*
+                    Streams the file into `sink` chunk by chunk and flushes it, so memory use
+                    does not grow with the output. An MTrk chunk whose events do not add up
+                    to its `get_len()` has its length patched in afterwards when the sink is
+                    seekable (a file or fd), and fails otherwise.
+                    */
+                    STATUS                  encode_to(MIDI_Sink& sink);
+
+                    /*
+                    Same output as `encode_to`, with the MTrk and UNkn chunks encoded into
+                    their own slice of `product` by up to `thread_count` threads (0 picks
+                    the hardware concurrency).
+                    */
+                    STATUS                  encode_parallel(std::vector<uint8_t>& product, unsigned thread_count = 0);
+
+#ifdef MIDI_STATS
+                    /*
+                    Counters for the output since the last `set_data` or `clear()`,
+                    whichever entry points were used (see `MIDI_Stats`).
+                    */
+    inline          const MIDI_Stats&       get_stats(){ return stats; }
+#endif
 };
 
 #endif
@@ -0,0 +1,48 @@
+#ifndef MIDI_LOADER_H
+#define MIDI_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Noncopyable.h"
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+
+/* ****************************************************************************
+*  MIDI_File_Loader
+*  ************************************************************************* */
+class MIDI_File_Loader :                    private Noncopyable<MIDI_File_Loader>
+{
+/*
+Gives the decoder direct access to the bytes of a .mid file.
+
+Regular files are mapped read-only and the kernel is told the mapping will be
+read sequentially, so the decoder reads straight from the page cache without an
+intermediate copy. Pipes, character devices and stdin (path "-") cannot be
+mapped; they are read into `buffer` instead.
+
+The bytes stay valid until `close()` is called, another file is opened or the
+loader is destroyed.
+*/
+protected:
+                    const uint8_t*          data{nullptr};
+                    size_t                  size{0};
+                    bool                    mapped{false};
+                    std::vector<uint8_t>    buffer{};
+                    MIDI_File_Decoder       decoder{};
+
+                    bool                    read_all(int fd);
+public:
+                                           ~MIDI_File_Loader();
+
+                    bool                    open(const char* path);
+                    void                    close();
+                    MIDI_Element_Decoder::STATUS load(const char* path, MIDI_File& product);
+
+    inline          const uint8_t*          get_data(){ return data; }
+    inline          size_t                  get_size(){ return size; }
+    inline          bool                    is_mapped(){ return mapped; }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef MIDI_SCANNER_H
+#define MIDI_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+
+/*
+Pre-pass over a MIDI file that is already in memory. Nothing is decoded or
+copied: `scan` only walks the chunk headers, and `validate` additionally checks
+every MTrk body with the rules of `MIDI_File_Decoder`, so a file can be accepted
+or rejected, and its tracks and events counted, at a fraction of the cost of
+decoding it.
+
+The byte loops are vectorised. Inside an MTrk body a bit mask of the bytes that
+have bit 7 set is built 64 bytes at a time; the end of a delta time or of a
+length (the first byte with bit 7 clear) is then found with a bit scan instead
+of a test per byte. Sysex payloads and tag searches are checked 16 or 32 bytes
+per step. SSE2 is used on x86-64, AVX2 when the CPU has it, and plain loops
+everywhere else.
+*/
+
+/* ****************************************************************************
+*  MIDI_Chunk_Span
+*  ************************************************************************* */
+struct MIDI_Chunk_Span
+{
+                    uint32_t                header{0};
+                    const uint8_t*          body{nullptr};
+                    uint32_t                len{0};
+                    size_t                  event_count{0}; // MTrk chunks, filled in by `validate`
+                    size_t                  byte_count{0};  // payload bytes the events will keep in the arena of an `MTrk_Chunk`
+};
+
+/* ****************************************************************************
+*  MIDI_Scanner
+*  ************************************************************************* */
+class MIDI_Scanner
+{
+/*
+`scan` expects an MThd chunk first and then, like `MIDI_File_Decoder`, locates
+as many chunks as the header announces (unknown chunks included); every chunk
+must fit in the buffer. Chunk 0 is the MThd chunk. Bytes after the last chunk
+are ignored.
+
+`validate` returns SUCCESS exactly when `MIDI_File_Decoder::decode` would
+succeed on the same complete buffer. A truncated file is a FAIL here.
+*/
+public:
+    enum class      KERNEL
+    {
+                                            SCALAR,
+                                            SSE2,
+                                            AVX2
+    };
+protected:
+                    std::vector<MIDI_Chunk_Span> chunks{};
+                    size_t                  size{0};
+                    size_t                  event_count{0};
+                    KERNEL                  kernel{best_kernel()};
+public:
+    static          KERNEL                  best_kernel();
+    static          bool                    supports(KERNEL new_kernel);
+
+                    bool                    set_kernel(KERNEL new_kernel); // false if the build or CPU lacks it
+    inline          KERNEL                  get_kernel(){ return kernel; }
+
+                    void                    clear();
+                    MIDI_Element_Decoder::STATUS scan(const uint8_t* data, size_t len);
+                    MIDI_Element_Decoder::STATUS validate(const uint8_t* data, size_t len);
+                    MIDI_Element_Decoder::STATUS check_track(const uint8_t* body, uint32_t len,
+                                                             size_t& events, size_t& bytes);
+
+                    /*
+                    Offset of the first occurrence of the 4-byte chunk tag `header` (e.g.
+                    `CHUNK_HEADER::MTHD`) in `data`, or `len` if there is none. Useful to
+                    find a standard MIDI file wrapped in another container, such as the
+                    "data" chunk of a RIFF RMID file.
+                    */
+                    size_t                  find_header(const uint8_t* data, size_t len, uint32_t header);
+
+    inline          size_t                  get_chunk_count(){ return chunks.size(); }
+    inline          MIDI_Chunk_Span&        get_chunk(size_t index){ return chunks[index]; }
+    inline          size_t                  get_size(){ return size; }
+    inline          size_t                  get_event_count(){ return event_count; }
+};
+
+#endif
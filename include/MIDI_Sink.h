@@ -0,0 +1,111 @@
+#ifndef MIDI_SINK_H
+#define MIDI_SINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "Noncopyable.h"
+
+/* ****************************************************************************
+*  MIDI_Sink
+*  ************************************************************************* */
+class MIDI_Sink :                           private Noncopyable<MIDI_Sink>
+{
+/*
+Destination for `MIDI_File_Encoder::encode_to(MIDI_Sink&)`. Bytes are collected
+in a fixed-size buffer and handed to `write_block` in blocks of that size, so
+the encoded file never has to exist in memory as a whole.
+
+`patch` overwrites bytes that were already written, e.g. a chunk length that is
+only known once the chunk has been encoded. Bytes still in the buffer can always
+be patched; bytes already flushed need a sink that supports `write_at`.
+
+Derived sinks flush in their destructor, but errors are only reported by an
+explicit `flush()`.
+*/
+protected:
+                    std::vector<uint8_t>    buffer{};
+                    size_t                  used{0};
+                    size_t                  flushed{0}; // bytes handed to write_block so far
+                    bool                    failed{false};
+
+                                            MIDI_Sink(size_t capacity);
+
+    virtual         bool                    write_block(const uint8_t* bytes, size_t count) = 0;
+    virtual         bool                    write_at(size_t position, const uint8_t* bytes, size_t count){ return false; }
+public:
+    virtual                                ~MIDI_Sink(){}
+
+                    bool                    write(const uint8_t* bytes, size_t count);
+                    bool                    flush();
+                    bool                    patch(size_t position, const uint8_t* bytes, size_t count);
+    virtual         bool                    seekable(){ return false; }
+
+    inline          size_t                  get_position(){ return flushed + used; }
+    inline          bool                    good(){ return !failed; }
+};
+
+/* ****************************************************************************
+*  MIDI_Fd_Sink
+*  ************************************************************************* */
+class MIDI_Fd_Sink :                        public MIDI_Sink
+{
+/*
+Writes to an open file descriptor, which is not closed. Regular files are
+seekable and patched with pwrite relative to the offset the sink started at.
+Interrupted writes are retried; a write that makes no progress fails.
+*/
+protected:
+                    int                     fd{-1};
+                    long long               start{-1};
+
+                    bool                    write_block(const uint8_t* bytes, size_t count);
+                    bool                    write_at(size_t position, const uint8_t* bytes, size_t count);
+public:
+                                            MIDI_Fd_Sink(int new_fd, size_t capacity = 1 << 16);
+                                           ~MIDI_Fd_Sink();
+
+                    bool                    seekable();
+};
+
+/* ****************************************************************************
+*  MIDI_Ostream_Sink
+*  ************************************************************************* */
+class MIDI_Ostream_Sink :                   public MIDI_Sink
+{
+protected:
+                    std::ostream&           stream;
+                    std::streampos          start{-1};
+
+                    bool                    write_block(const uint8_t* bytes, size_t count);
+                    bool                    write_at(size_t position, const uint8_t* bytes, size_t count);
+public:
+                                            MIDI_Ostream_Sink(std::ostream& new_stream, size_t capacity = 1 << 16);
+                                           ~MIDI_Ostream_Sink();
+
+                    bool                    seekable();
+};
+
+/* ****************************************************************************
+*  MIDI_Callback_Sink
+*  ************************************************************************* */
+class MIDI_Callback_Sink :                  public MIDI_Sink
+{
+/*
+Hands each block to a user function, which returns false to abort encoding.
+Not seekable.
+*/
+protected:
+                    std::function<bool(const uint8_t*, size_t)> callback;
+
+                    bool                    write_block(const uint8_t* bytes, size_t count);
+public:
+                                            MIDI_Callback_Sink(std::function<bool(const uint8_t*, size_t)> new_callback,
+                                                               size_t capacity = 1 << 16);
+                                           ~MIDI_Callback_Sink();
+};
+
+#endif
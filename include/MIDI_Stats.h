@@ -0,0 +1,89 @@
+#ifndef MIDI_STATS_H
+#define MIDI_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Counters filled in by `MIDI_File_Decoder` and `MIDI_File_Encoder` when the
+library is built with `-DMIDI_STATS`. Without it the decoders and encoders
+carry no counters and no timing code at all; the structs below are only
+declared so that code reading them compiles either way.
+*/
+
+/* ****************************************************************************
+*  MIDI_Chunk_Stats
+*  ************************************************************************* */
+struct MIDI_Chunk_Stats
+{
+                    uint32_t                header{0};
+                    uint64_t                bytes{0};       // chunk tag and length included
+                    uint64_t                events{0};      // MTrk chunks
+                    uint64_t                nanoseconds{0}; // bulk entry points only, 0 byte at a time
+};
+
+/* ****************************************************************************
+*  MIDI_Stats
+*  ************************************************************************* */
+struct MIDI_Stats
+{
+/*
+Totals over everything a decoder or encoder handled since its last `clear()`.
+
+`running_status` counts channel events that have no status byte of their own:
+read without one by a decoder, written without one by an encoder.
+
+`dt_varlen[n]` and `length_varlen[n]` count delta times and meta or sysex
+lengths that take `n` bytes (1 to 4) in the file.
+
+`allocations` counts the times the product had to grow while it was filled: the
+event table or payload arena of an MTrk chunk, the bytes of an unknown chunk,
+the extended MThd content or the output vector. A file decoded into a cleared
+`MIDI_File` that has already held a larger one allocates nothing.
+
+`chunks` has one entry per chunk, MThd first, in file order.
+*/
+                    uint64_t                mthd_bytes{0};
+                    uint64_t                mtrk_bytes{0};
+                    uint64_t                unkn_bytes{0};
+                    uint64_t                channel_events{0};
+                    uint64_t                meta_events{0};
+                    uint64_t                sysex_events{0};
+                    uint64_t                running_status{0};
+                    uint64_t                dt_varlen[5]{};
+                    uint64_t                length_varlen[5]{};
+                    uint64_t                allocations{0};
+                    std::vector<MIDI_Chunk_Stats> chunks{};
+
+    inline          void                    clear()
+                    {
+                        std::vector<MIDI_Chunk_Stats> kept{};
+
+                        kept.swap(chunks); // keep the capacity for the next file
+                        *this = MIDI_Stats();
+                        kept.clear();
+                        chunks.swap(kept);
+                    }
+
+                    /*
+                    Adds the event counters of `other`, e.g. those of one thread of
+                    `decode_parallel`. Byte totals and `chunks` are left alone.
+                    */
+    inline          void                    add_events(const MIDI_Stats& other)
+                    {
+                        channel_events += other.channel_events;
+                        meta_events += other.meta_events;
+                        sysex_events += other.sysex_events;
+                        running_status += other.running_status;
+                        allocations += other.allocations;
+
+                        for (size_t i = 0; i < 5; ++i)
+                        {
+                            dt_varlen[i] += other.dt_varlen[i];
+                            length_varlen[i] += other.length_varlen[i];
+                        }
+                    }
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef MIDI_TEMPO_H
+#define MIDI_TEMPO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MIDI_Data.h"
+
+/*
+Conversion between ticks and wall-clock time. A `MIDI_Tempo_Map` is built once
+from the division of the MThd chunk and the set tempo meta events (FF 51 03
+tttttt) of the tracks, and then answers conversions in both directions with a
+binary search over its segments, without walking the tracks again.
+*/
+
+/* ****************************************************************************
+*  MIDI_Tempo_Segment
+*  ************************************************************************* */
+struct MIDI_Tempo_Segment
+{
+/*
+A run of ticks at one tempo, from `tick` up to the tick of the next segment.
+`scaled_us` is the time at `tick` in microseconds multiplied by the divisor of
+the map, which keeps every segment start exact however many tempo changes come
+before it.
+*/
+                    uint64_t                tick{0};
+                    uint64_t                scaled_us{0};
+                    uint32_t                tempo{0}; // microseconds per `get_divisor()` ticks
+};
+
+/* ****************************************************************************
+*  MIDI_Tempo_Map
+*  ************************************************************************* */
+class MIDI_Tempo_Map
+{
+/*
+With a metrical division (bit 15 of `div` clear) the divisor is the number of
+ticks per quarter note and `tempo` the microseconds per quarter note: 500000
+(120 BPM) until the first tempo event, then as set. All tempo events of all
+tracks are merged, so a tempo change in any track of a format 1 file applies to
+every track; of several changes at the same tick the last one, in track order,
+wins. Tempo events with a length other than 3 or a tempo of 0 are ignored. For a
+format 2 file, whose tracks are independent, build one map per track.
+
+With an SMPTE division (bit 15 set) the tempo events are ignored and a tick
+lasts 1 / (frames per second * ticks per frame) seconds; -29 frames per second
+is taken as 29.97 (30000 / 1001).
+
+`build` returns false, and leaves the map empty, when the division is 0 or has
+0 ticks per frame. An empty map converts everything to 0.
+
+Times are rounded down to whole microseconds and ticks to whole ticks:
+`to_ticks(microseconds)` is the last tick that starts at or before
+`microseconds`, so `to_ticks(to_microseconds(tick))` may be less than `tick`.
+*/
+protected:
+                    std::vector<MIDI_Tempo_Segment> segments{};
+                    std::vector<MIDI_Tempo_Segment> changes{}; // tempo events in track order, reused by `build`
+                    uint32_t                divisor{0};
+                    bool                    smpte{false};
+
+                    bool                    set_div(uint16_t div);
+                    void                    add_changes(MTrk_Chunk& track);
+                    void                    make_segments();
+                    size_t                  find_tick(uint64_t tick);
+                    size_t                  next_tick(size_t index, uint64_t tick); // `find_tick` starting from segment `index`
+                    size_t                  find_scaled_us(uint64_t scaled_us);
+    inline          uint64_t                convert(const MIDI_Tempo_Segment& segment, uint64_t tick)
+                    {
+                        return (segment.scaled_us + (tick - segment.tick) * segment.tempo) / divisor;
+                    }
+public:
+    static const    uint32_t                DEFAULT_TEMPO{500000};
+
+                    void                    clear();
+                    bool                    build(MIDI_File& file);
+                    bool                    build(MThd_Chunk& hdr, MTrk_Chunk& track);
+
+                    uint64_t                to_microseconds(uint64_t tick);
+                    uint64_t                to_ticks(uint64_t microseconds);
+                    uint32_t                get_tempo(uint64_t tick); // `tempo` of the segment holding `tick`
+
+                    /*
+                    Convert `count` ticks into `out`. When `ticks` is sorted the segments are
+                    walked forwards once, so the whole batch costs O(count + segments); an
+                    unsorted batch is still converted correctly, with a binary search for
+                    each tick that goes backwards.
+                    */
+                    void                    to_microseconds(const uint64_t* ticks, size_t count, uint64_t* out);
+                    void                    to_microseconds(const Channel_Event* events, size_t count, uint64_t* out);
+
+    inline          bool                    is_smpte(){ return smpte; }
+    inline          uint32_t                get_divisor(){ return divisor; }
+    inline          size_t                  get_segment_count(){ return segments.size(); }
+    inline          MIDI_Tempo_Segment&     get_segment(size_t index){ return segments[index]; }
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef MIDI_VIEW_H
+#define MIDI_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MIDI_Data.h"
+#include "MIDI_Decoder.h"
+
+/*
+Read-only views over a MIDI file that is already in memory (for example through
+`MIDI_File_Loader`). Nothing is copied out of the buffer: chunks are located
+once by `MIDI_File_View::index` and MTrk events are parsed lazily while a track
+is iterated. The buffer must outlive every view made from it.
+
+The getters mirror `MThd_Chunk`, `MTrk_Chunk` and `MTrk_Event` so code that only
+reads a `MIDI_File` can switch to the views with few changes.
+*/
+
+/* ****************************************************************************
+*  MIDI_Chunk_View
+*  ************************************************************************* */
+class MIDI_Chunk_View
+{
+protected:
+                    const uint8_t*          body{nullptr};
+                    uint32_t                header{0};
+                    uint32_t                len{0};
+public:
+                                            MIDI_Chunk_View(){}
+                                            MIDI_Chunk_View(uint32_t new_header, const uint8_t* new_body, uint32_t new_len):
+                                                body{new_body}, header{new_header}, len{new_len}{}
+
+    inline          uint32_t                get_header(){ return header; }
+    inline          uint32_t                get_len(){ return len; }
+    inline          const uint8_t*          get_body(){ return body; }
+};
+
+/* ****************************************************************************
+*  MThd_View
+*  ************************************************************************* */
+class MThd_View :                           public MIDI_Chunk_View
+{
+public:
+                                            MThd_View(){}
+                                            MThd_View(const MIDI_Chunk_View& chunk): MIDI_Chunk_View(chunk){}
+
+                    uint16_t                get_fmt();
+                    uint16_t                get_ntrks();
+                    uint16_t                get_div();
+    inline          size_t                  get_extended_size(){ return (len > 6) ? (len - 6) : 0; }
+
+                    uint8_t                 operator[](size_t index); // extended content, as MThd_Chunk
+};
+
+/* ****************************************************************************
+*  MTrk_Event_View
+*  ************************************************************************* */
+class MTrk_Event_View
+{
+/*
+One event of an `MTrk_View`. The payload is laid out as in `MTrk_Event`: byte 0
+is the status (restored when the file relies on running status), followed by the
+data bytes, which are read in place from the buffer. As in `MTrk_Event`, meta
+events keep their type and length bytes and sysex events do not keep their
+length. The channel message getters behave as those of `MTrk_Event`.
+*/
+    friend class MTrk_Event_Iterator;
+protected:
+                    const uint8_t*          data{nullptr}; // payload bytes after the status byte
+                    uint32_t                dt{0};
+                    uint32_t                length{0};
+                    uint8_t                 status{0};
+public:
+    inline          uint32_t                get_dt(){ return dt; }
+    inline          uint8_t                 get_status(){ return status; }
+    inline          STATUS_CLASS            get_status_class(){ return STATUS_TABLE[status].type; }
+    inline          uint8_t                 get_command(){ return status & 0xF0; }
+    inline          uint8_t                 get_channel(){ return status & 0x0F; }
+    inline          uint8_t                 get_data1(){ return (length > 1) ? data[0] : 0; }
+    inline          uint8_t                 get_data2(){ return (length > 2) ? data[1] : 0; }
+    inline          uint16_t                get_pitch_bend(){ return (uint16_t)(get_data1() | (get_data2() << 7)); }
+                    uint32_t                get_size();
+    inline          uint32_t                get_payload_size(){ return length; }
+    inline          const uint8_t*          get_data(){ return data; }
+    inline          uint8_t                 operator[](size_t index){ return (index == 0) ? status : data[index - 1]; }
+};
+
+/* ****************************************************************************
+*  MTrk_Event_Iterator
+*  ************************************************************************* */
+class MTrk_Event_Iterator
+{
+/*
+Forward iterator over the events of an MTrk chunk body. Each increment parses
+one event and tracks running status. A malformed event ends the iteration early
+and sets `failed()`.
+*/
+protected:
+                    const uint8_t*          p{nullptr};
+                    const uint8_t*          end{nullptr};
+                    uint8_t                 running_status{0};
+                    bool                    fail{false};
+                    MTrk_Event_View         event{};
+
+                    void                    next();
+public:
+                                            MTrk_Event_Iterator(){}
+                                            MTrk_Event_Iterator(const uint8_t* body, uint32_t len);
+
+    inline          bool                    failed(){ return fail; }
+    inline          MTrk_Event_View&        operator*(){ return event; }
+    inline          MTrk_Event_View*        operator->(){ return &event; }
+    inline          MTrk_Event_Iterator&    operator++(){ next(); return *this; }
+    inline          bool                    operator==(const MTrk_Event_Iterator& other) const { return event.data == other.event.data; }
+    inline          bool                    operator!=(const MTrk_Event_Iterator& other) const { return event.data != other.event.data; }
+};
+
+/* ****************************************************************************
+*  MTrk_View
+*  ************************************************************************* */
+class MTrk_View :                           public MIDI_Chunk_View
+{
+/*
+Events are not indexed; `size()` and `check()` walk the whole track.
+*/
+public:
+                                            MTrk_View(){}
+                                            MTrk_View(const MIDI_Chunk_View& chunk): MIDI_Chunk_View(chunk){}
+
+    inline          MTrk_Event_Iterator     begin(){ return MTrk_Event_Iterator(body, len); }
+    inline          MTrk_Event_Iterator     end(){ return MTrk_Event_Iterator(); }
+                    size_t                  size();
+                    MIDI_Element_Decoder::STATUS check();
+};
+
+/* ****************************************************************************
+*  UNkn_View
+*  ************************************************************************* */
+class UNkn_View :                           public MIDI_Chunk_View
+{
+public:
+                                            UNkn_View(){}
+                                            UNkn_View(const MIDI_Chunk_View& chunk): MIDI_Chunk_View(chunk){}
+
+    inline          uint8_t                 operator[](size_t index){ return body[index]; }
+};
+
+/* ****************************************************************************
+*  MIDI_File_View
+*  ************************************************************************* */
+class MIDI_File_View
+{
+/*
+`index` expects an MThd chunk first and then, like `MIDI_File_Decoder`, reads as
+many chunks as the header announces (unknown chunks included). It checks that
+every chunk fits in the buffer but does not parse MTrk events.
+*/
+protected:
+                    MThd_View               hdr{};
+                    std::vector<MIDI_Chunk_View> ordered_chunks{};
+                    std::vector<MTrk_View>  mtrk_chunks{};
+                    std::vector<UNkn_View>  unkn_chunks{};
+public:
+                    void                    clear();
+                    MIDI_Element_Decoder::STATUS index(const uint8_t* data, size_t len);
+
+    inline          MThd_View&              get_hdr(){ return hdr; }
+    inline          size_t                  get_chunk_count(){ return ordered_chunks.size(); }
+    inline          MIDI_Chunk_View&        get_chunk(size_t index){ return ordered_chunks[index]; }
+    inline          size_t                  get_MTrk_count(){ return mtrk_chunks.size(); }
+    inline          MTrk_View&              get_MTrk(size_t index){ return mtrk_chunks[index]; }
+    inline          UNkn_View&              get_UNkn(size_t index){ return unkn_chunks[index]; }
+    inline          MTrk_View&              operator[](size_t index){ return mtrk_chunks[index]; }
+};
+
+#endif
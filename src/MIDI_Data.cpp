@@ -1,43 +1,249 @@
+#include <algorithm>
+
 #include "MIDI_Data.h"
 
 /* ****************************************************************************
-*  Varlen
+*  MTrk_Event
 *  ************************************************************************* */
-int Varlen::byte_count(uint32_t vlq)
+MTrk_Event::MTrk_Event(const MTrk_Event& other) :
+    dt(other.dt)
 {
-    int count = 1;
+    // a copy never shares arena bytes with the original
+    store(const_cast<MTrk_Event&>(other).get_payload(), other.length);
+}
 
-    if (vlq < 0x8000)
+MTrk_Event::MTrk_Event(MTrk_Event&& other) :
+    dt(other.dt),
+    status(other.status)
+{
+    if (other.owner != nullptr)
     {
-        count = 1;
+        // an event moved out of a chunk is detached, and the chunk keeps its bytes
+        store(other.get_payload(), other.length);
     }
-    else if (vlq <= 0x800000)
+    else
     {
-        count = 2;
+        take(other);
     }
-    else if (vlq < 0x80000000)
+}
+
+MTrk_Event::~MTrk_Event()
+{
+    release();
+}
+
+MTrk_Event& MTrk_Event::operator=(const MTrk_Event& other)
+{
+    if (this == &other)
     {
-        count = 3;
+        return *this;
+    }
+
+    size_t index = (owner != nullptr) ? owner->index_of(*this) : 0;
+    uint32_t before = (owner != nullptr) ? owner->local_size(index) : 0;
+    MTrk_Event copied(other); // `other` may be stored in the same arena
+
+    if (storage == STORAGE::ARENA)
+    {
+        owner->garbage += length;
+    }
+
+    release();
+
+    if (owner != nullptr)
+    {
+        // long payloads of a chunk's events stay in its arena
+        length = 0;
+        store(copied.get_payload(), copied.length);
     }
     else
     {
-        count = 4;
+        take(copied);
+    }
+
+    dt = other.dt;
+    status = other.status;
+
+    if (owner != nullptr)
+    {
+        owner->len += owner->local_size(index) - before;
+        owner->invalidate(index);
+    }
+
+    return *this;
+}
+
+MTrk_Event& MTrk_Event::operator=(MTrk_Event&& other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+
+    if (other.owner != nullptr)
+    {
+        // the payload stays with the event of its chunk, whose length must not change
+        return *this = static_cast<const MTrk_Event&>(other);
+    }
+
+    size_t index = (owner != nullptr) ? owner->index_of(*this) : 0;
+    uint32_t before = (owner != nullptr) ? owner->local_size(index) : 0;
+
+    if (storage == STORAGE::ARENA)
+    {
+        owner->garbage += length;
+    }
+
+    release();
+
+    dt = other.dt;
+    status = other.status;
+    take(other); // inline bytes or heap buffer of a detached event
+
+    if (owner != nullptr)
+    {
+        owner->len += owner->local_size(index) - before;
+        owner->invalidate(index);
     }
 
-    return count;
+    return *this;
 }
 
-int Varlen::byte_count()
+void MTrk_Event::relocate(MTrk_Event& other)
 {
-    return byte_count(payload);
+    /*
+    Takes over the slot of `other` when `MTrk_Chunk` shifts its table: both are
+    events of the same chunk, so arena offsets stay valid, and the track itself
+    does not change, so neither `len` nor the index is touched. `other` is about
+    to be overwritten or dropped by the chunk.
+    */
+    release();
+
+    dt = other.dt;
+    status = other.status;
+    take(other);
+}
+
+void MTrk_Event::release()
+{
+    if (storage == STORAGE::HEAP)
+    {
+        delete get_heap();
+    }
+
+    storage = STORAGE::INLINE;
+}
+
+void MTrk_Event::take(MTrk_Event& other)
+{
+    // the payload of `other` as is: inline bytes, arena offset or heap buffer
+    std::memcpy(local, other.local, sizeof(local));
+    length = other.length;
+    storage = other.storage;
+
+    if (other.storage == STORAGE::HEAP)
+    {
+        other.storage = STORAGE::INLINE;
+        other.length = 0;
+    }
+}
+
+void MTrk_Event::spill()
+{
+    // the inline payload is about to outgrow `local`
+    if (owner != nullptr)
+    {
+        uint32_t offset = (uint32_t)owner->arena.size();
+
+        owner->arena.insert(owner->arena.end(), local, local + length);
+        set_offset(offset);
+        storage = STORAGE::ARENA;
+    }
+    else
+    {
+        set_heap(new std::vector<uint8_t>(local, local + length));
+        storage = STORAGE::HEAP;
+    }
+}
+
+void MTrk_Event::store(const uint8_t* new_bytes, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (length == 0)
+    {
+        status = new_bytes[0];
+    }
+
+    if ((storage == STORAGE::INLINE) && ((length + count) <= INLINE_CAPACITY))
+    {
+        std::memcpy(local + length, new_bytes, count);
+    }
+    else
+    {
+        if (storage == STORAGE::INLINE)
+        {
+            spill();
+        }
+
+        if (storage == STORAGE::ARENA)
+        {
+            owner->append(*this, new_bytes, count);
+        }
+        else
+        {
+            std::vector<uint8_t>* heap = get_heap();
+            heap->insert(heap->end(), new_bytes, new_bytes + count);
+        }
+    }
+
+    length += (uint32_t)count;
+}
+
+void MTrk_Event::clear()
+{
+    size_t index = (owner != nullptr) ? owner->index_of(*this) : 0;
+    uint32_t before = (owner != nullptr) ? owner->local_size(index) : 0;
+
+    if (storage == STORAGE::HEAP)
+    {
+        get_heap()->clear();
+    }
+    else if (storage == STORAGE::ARENA)
+    {
+        owner->garbage += length;
+        storage = STORAGE::INLINE;
+    }
+
+    dt.set_data(0);
+    length = 0;
+    status = 0;
+
+    if (owner != nullptr)
+    {
+        owner->len += owner->local_size(index) - before;
+        owner->invalidate(index);
+    }
 }
 
-/* ****************************************************************************
-*  MTrk_Event
-*  ************************************************************************* */
 void MTrk_Event::set_dt(uint32_t new_dt)
 {
+    if (owner == nullptr)
+    {
+        dt.set_data(new_dt);
+        return;
+    }
+
+    size_t index = owner->index_of(*this);
+    uint32_t before = owner->local_size(index);
+
     dt.set_data(new_dt);
+
+    owner->len += owner->local_size(index) - before;
+    owner->invalidate(index);
 }
 
 uint32_t MTrk_Event::get_size()
@@ -47,23 +253,61 @@ uint32_t MTrk_Event::get_size()
     size += dt.byte_count();
     size += get_payload_size();
 
-    if ((bytes[0] == STATUS_BYTE::SYSEX_F0) || (bytes[0] == STATUS_BYTE::SYSEX_F7))
+    if ((length > 0) && ((status == STATUS_BYTE::SYSEX_F0) || (status == STATUS_BYTE::SYSEX_F7)))
     {
-        size += Varlen::byte_count(get_payload_size());
+        size += Varlen::byte_count(get_payload_size() - 1); // len is byte count AFTER F0/F7
     }
 
     return size;
 
 }
 
+const uint8_t* MTrk_Event::get_payload()
+{
+    switch (storage)
+    {
+        case STORAGE::ARENA:
+        {
+            return owner->arena.data() + get_offset();
+        }
+        case STORAGE::HEAP:
+        {
+            return get_heap()->data();
+        }
+        default:
+        {
+            return local;
+        }
+    }
+}
+
 void MTrk_Event::push_byte(uint8_t new_byte)
 {
-    bytes.push_back(new_byte);
+    push_bytes(&new_byte, 1);
+}
+
+void MTrk_Event::push_bytes(const uint8_t* new_bytes, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    size_t index = (owner != nullptr) ? owner->index_of(*this) : 0;
+    uint32_t before = (owner != nullptr) ? owner->local_size(index) : 0;
+
+    store(new_bytes, count);
+
+    if (owner != nullptr)
+    {
+        owner->len += owner->local_size(index) - before;
+        owner->invalidate(index);
+    }
 }
 
 uint8_t MTrk_Event::operator[](size_t index)
 {
-    return bytes[index];
+    return get_payload()[index];
 }
 
 /* ****************************************************************************
@@ -100,6 +344,21 @@ MThd_Chunk::MThd_Chunk()
     header = CHUNK_HEADER::MTHD;
 }
 
+MThd_Chunk::MThd_Chunk(const allocator_type& alloc) :
+    extended_content(alloc)
+{
+    header = CHUNK_HEADER::MTHD;
+}
+
+MThd_Chunk::MThd_Chunk(const MThd_Chunk& other, const allocator_type& alloc) :
+    MIDI_Chunk(other),
+    fmt(other.fmt),
+    ntrks(other.ntrks),
+    div(other.div),
+    extended_content(other.extended_content, alloc)
+{
+}
+
 uint16_t MThd_Chunk::get_fmt()
 {
     return fmt;
@@ -135,6 +394,20 @@ void MThd_Chunk::push_byte(uint8_t new_byte)
     extended_content.push_back(new_byte);
 }
 
+void MThd_Chunk::push_bytes(const uint8_t* new_bytes, size_t count)
+{
+    extended_content.insert(extended_content.end(), new_bytes, new_bytes + count);
+}
+
+void MThd_Chunk::clear()
+{
+    len = 0;
+    fmt = 0;
+    ntrks = 0;
+    div = 0;
+    extended_content.clear();
+}
+
 uint8_t& MThd_Chunk::operator[](size_t index)
 {
     return extended_content[index];
@@ -148,89 +421,493 @@ MTrk_Chunk::MTrk_Chunk()
     header = CHUNK_HEADER::MTRK;
 }
 
-uint32_t MTrk_Chunk::update_chunk_size()
+MTrk_Chunk::MTrk_Chunk(const allocator_type& alloc) :
+    events(alloc),
+    arena(alloc),
+    ticks(alloc),
+    checkpoints(alloc)
+{
+    header = CHUNK_HEADER::MTRK;
+}
+
+MTrk_Chunk::MTrk_Chunk(const MTrk_Chunk& other) :
+    MIDI_Chunk(other)
 {
-    uint32_t size = 0;
-    auto it = events.begin();
+    copy_events(other);
+}
+
+MTrk_Chunk::MTrk_Chunk(const MTrk_Chunk& other, const allocator_type& alloc) :
+    MIDI_Chunk(other),
+    events(alloc),
+    arena(alloc),
+    ticks(alloc),
+    checkpoints(alloc)
+{
+    copy_events(other);
+}
 
-    while(it != events.end())
+MTrk_Chunk::MTrk_Chunk(MTrk_Chunk&& other) noexcept :
+    MIDI_Chunk(other),
+    events(std::move(other.events)),
+    arena(std::move(other.arena)),
+    garbage(other.garbage),
+    ticks(std::move(other.ticks)),
+    checkpoints(std::move(other.checkpoints)),
+    indexed(other.indexed)
+{
+    other.clear();
+    rebind();
+}
+
+MTrk_Chunk::MTrk_Chunk(MTrk_Chunk&& other, const allocator_type& alloc) :
+    MIDI_Chunk(other),
+    events(alloc),
+    arena(alloc),
+    ticks(alloc),
+    checkpoints(alloc)
+{
+    take_events(other);
+}
+
+MTrk_Chunk& MTrk_Chunk::operator=(const MTrk_Chunk& other)
+{
+    if (this != &other)
     {
-        size += (*it).get_size();
+        MIDI_Chunk::operator=(other);
+        events.clear();
+        arena.clear();
+        garbage = 0;
+        indexed = 0;
+        copy_events(other);
+    }
+
+    return *this;
+}
 
-        ++it;
+MTrk_Chunk& MTrk_Chunk::operator=(MTrk_Chunk&& other)
+{
+    if (this != &other)
+    {
+        clear();
+        MIDI_Chunk::operator=(other);
+        take_events(other);
+    }
+
+    return *this;
+}
+
+void MTrk_Chunk::take_events(MTrk_Chunk& other)
+{
+    // the table and the arena of this chunk are empty
+    if (arena.get_allocator() == other.arena.get_allocator())
+    {
+        events.swap(other.events);
+        arena.swap(other.arena);
+        ticks.swap(other.ticks);
+        checkpoints.swap(other.checkpoints);
+        garbage = other.garbage;
+        indexed = other.indexed;
+        rebind();
+    }
+    else
+    {
+        // moving the events one by one would detach them: copy them into this arena instead
+        copy_events(other);
+    }
+
+    other.clear();
+}
+
+void MTrk_Chunk::copy_events(const MTrk_Chunk& other)
+{
+    MTrk_Chunk& src = const_cast<MTrk_Chunk&>(other);
+
+    events.reserve(src.events.size());
+    arena.reserve(src.arena.size() - src.garbage);
+
+    for (MTrk_Event& event : src.events)
+    {
+        MTrk_Event& copy = events.emplace_back();
+        copy.owner = this;
+        copy.dt = event.dt;
+        copy.store(event.get_payload(), event.length);
+    }
+}
+
+void MTrk_Chunk::rebind()
+{
+    for (MTrk_Event& event : events)
+    {
+        event.owner = this;
+    }
+}
+
+void MTrk_Chunk::append(MTrk_Event& event, const uint8_t* new_bytes, size_t count)
+{
+    uint32_t offset = event.get_offset();
+
+    if ((offset + event.length) != arena.size())
+    {
+        // only the event at the end of the arena can grow in place
+        size_t moved_to = arena.size();
+        arena.resize(moved_to + event.length);
+        std::copy(arena.begin() + offset, arena.begin() + offset + event.length, arena.begin() + moved_to);
+        garbage += event.length;
+        event.set_offset((uint32_t)moved_to);
+    }
+
+    arena.insert(arena.end(), new_bytes, new_bytes + count);
+}
+
+size_t MTrk_Chunk::index_of(MTrk_Event& event)
+{
+    // events are contiguous: an event belongs to the table iff it lies inside it
+    if ((&event < events.data()) || (&event >= (events.data() + events.size())))
+    {
+        return events.size();
+    }
+
+    return (size_t)(&event - events.data());
+}
+
+uint32_t MTrk_Chunk::event_size(size_t index)
+{
+    /*
+    Number of bytes `MTrk_Encoder` writes for `events[index]`. Only the previous
+    event matters: running status is reset by meta and sysex events and the
+    status byte of a MIDI event is omitted when it repeats the previous one.
+    */
+    if (index >= events.size())
+    {
+        return 0;
+    }
+
+    MTrk_Event& event = events[index];
+    uint32_t size = (uint32_t)event.dt.byte_count() + event.length;
+
+    if (event.length == 0)
+    {
+        return size;
+    }
+
+    if ((event.status == STATUS_BYTE::SYSEX_F0) || (event.status == STATUS_BYTE::SYSEX_F7))
+    {
+        size += (uint32_t)Varlen::byte_count(event.length - 1);
+    }
+    else if ((event.status != STATUS_BYTE::META) && ENCODE_RUNNING_STATUS && (index > 0) && (event.length > 1))
+    {
+        MTrk_Event& previous = events[index - 1];
+
+        if ((previous.length > 0) && (previous.status == event.status))
+        {
+            size -= 1;
+        }
     }
 
     return size;
+}
 
+uint32_t MTrk_Chunk::local_size(size_t index)
+{
+    return event_size(index) + event_size(index + 1);
 }
 
 MTrk_Event& MTrk_Chunk::emplace_back_event()
 {
-    auto tmp = events.emplace_back();
-    update_chunk_size();
+    make_room(events.size() + 1);
+
+    MTrk_Event& tmp = events.emplace_back();
+    tmp.owner = this;
+    len += event_size(events.size() - 1);
     return tmp;
 }
 
 MTrk_Event& MTrk_Chunk::emplace_event(size_t index)
 {
-    auto it = events.begin();
+    if (index > events.size())
+    {
+        index = events.size();
+    }
 
-    for (size_t i = 0; i < index; ++i)
+    uint32_t before = event_size(index);
+
+    make_room(events.size() + 1);
+    events.emplace_back().owner = this;
+
+    for (size_t i = events.size() - 1; i > index; --i)
     {
-        if (it == events.end())
-        {
-            return *events.end();
-        }
-        else
-        {
-            ++it;
-        }
+        events[i].relocate(events[i - 1]);
     }
 
-    auto tmp = *events.emplace(it);
-    update_chunk_size();
+    // the slot at `index` was taken over by the next one
+    MTrk_Event& tmp = events[index];
+    tmp.storage = MTrk_Event::STORAGE::INLINE;
+    tmp.length = 0;
+    tmp.status = 0;
+    tmp.dt = Varlen{};
+
+    len += local_size(index) - before;
+    invalidate(index);
     return tmp;
 }
 
-MTrk_Event& MTrk_Chunk::insert_event(size_t index, MTrk_Event& event)
+MTrk_Event& MTrk_Chunk::insert_event(size_t index, const MTrk_Event& event)
 {
-    auto it = events.begin();
+    MTrk_Event copy(event); // `event` may be an element of `events`
 
-    for (size_t i = 0; i < index; ++i)
+    MTrk_Event& tmp = emplace_event(index);
+    tmp.set_dt(copy.get_dt());
+    tmp.push_bytes(copy.get_payload(), copy.get_payload_size());
+    return tmp;
+}
+
+MTrk_Event& MTrk_Chunk::insert_event(size_t index, MTrk_Event&& event)
+{
+    if ((event.owner != nullptr) && (event.owner != this))
     {
-        if (it == events.end())
-        {
-            return *events.end();
-        }
-        else
-        {
-            ++it;
-        }
+        // the payload is in another chunk's arena and has to be copied
+        MTrk_Event& tmp = insert_event(index, static_cast<const MTrk_Event&>(event));
+        event.clear();
+        return tmp;
+    }
+
+    size_t from = index_of(event);
+    uint32_t before = (from < events.size()) ? local_size(from) : 0;
+    MTrk_Event moved{};
+
+    // arena offset or heap buffer, nothing is copied
+    moved.dt = event.dt;
+    moved.status = event.status;
+    moved.take(event);
+
+    // `event` stays in place, without the payload `moved` now holds
+    event.storage = MTrk_Event::STORAGE::INLINE;
+    event.length = 0;
+    event.status = 0;
+
+    if (from < events.size())
+    {
+        len += local_size(from) - before;
+        invalidate(from);
     }
 
-    auto tmp = *events.insert(it, event);
-    update_chunk_size();
+    MTrk_Event& tmp = emplace_event(index);
+    size_t at = index_of(tmp);
+
+    before = local_size(at);
+
+    tmp.dt = moved.dt;
+    tmp.status = moved.status;
+    tmp.take(moved);
+
+    len += local_size(at) - before;
+    invalidate(at);
     return tmp;
 }
 
 void MTrk_Chunk::erase(size_t index)
 {
-    auto it = events.begin();
+    if (index >= events.size())
+    {
+        return;
+    }
 
-    for (size_t i = 0; i < index; ++i)
+    if (events[index].storage == MTrk_Event::STORAGE::ARENA)
     {
-        if (it == events.end())
+        garbage += events[index].length;
+    }
+
+    uint32_t before = local_size(index);
+
+    for (size_t i = index; (i + 1) < events.size(); ++i)
+    {
+        events[i].relocate(events[i + 1]);
+    }
+
+    events.pop_back();
+
+    len += event_size(index) - before;
+    invalidate(index);
+
+    if (garbage > (arena.size() / 2))
+    {
+        compact();
+    }
+}
+
+void MTrk_Chunk::reserve(size_t event_count, size_t byte_count)
+{
+    make_room(event_count);
+    arena.reserve(byte_count);
+}
+
+void MTrk_Chunk::make_room(size_t event_count)
+{
+    /*
+    The table is never reallocated by `std::vector` itself, which would move
+    each event out of the chunk and so detach it: events are relocated into
+    the new table, keeping their arena offsets.
+    */
+    if (event_count <= events.capacity())
+    {
+        return;
+    }
+
+    std::pmr::vector<MTrk_Event> moved(events.get_allocator());
+    moved.reserve(std::max(event_count, events.capacity() * 2));
+
+    for (MTrk_Event& event : events)
+    {
+        MTrk_Event& slot = moved.emplace_back();
+        slot.owner = this;
+        slot.relocate(event);
+    }
+
+    events.swap(moved);
+}
+
+void MTrk_Chunk::compact()
+{
+    std::pmr::vector<uint8_t> packed(arena.get_allocator());
+    packed.reserve(arena.size() - garbage);
+
+    for (MTrk_Event& event : events)
+    {
+        if (event.storage == MTrk_Event::STORAGE::INLINE)
         {
-            break;
+            continue;
+        }
+
+        const uint8_t* payload = event.get_payload();
+
+        if (event.length <= MTrk_Event::INLINE_CAPACITY)
+        {
+            // a short payload left in a heap buffer moves back into the event
+            uint8_t bytes[MTrk_Event::INLINE_CAPACITY];
+
+            std::memcpy(bytes, payload, event.length);
+            event.release();
+            std::memcpy(event.local, bytes, event.length);
         }
         else
         {
-            ++it;
+            uint32_t moved_to = (uint32_t)packed.size();
+
+            packed.insert(packed.end(), payload, payload + event.length);
+            event.release();
+            event.storage = MTrk_Event::STORAGE::ARENA;
+            event.set_offset(moved_to);
         }
     }
 
-    events.erase(it);
-    update_chunk_size();
+    arena.swap(packed);
+    garbage = 0;
+}
+
+void MTrk_Chunk::clear()
+{
+    events.clear();
+    arena.clear();
+    garbage = 0;
+    len = 0;
+    ticks.clear();
+    checkpoints.clear();
+    indexed = 0;
+}
+
+void MTrk_Chunk::update_index()
+{
+    if ((indexed == events.size()) && (ticks.size() == events.size()))
+    {
+        return;
+    }
+
+    /*
+    Entries before `indexed` are current. Checkpoints from `indexed` on are
+    rebuilt, starting again at the last checkpoint before it, whose offset and
+    running status only depend on the events in front of it.
+    */
+    size_t start = 0;
+    uint32_t offset = 0;
+
+    while (!checkpoints.empty() && (checkpoints.back().event >= indexed))
+    {
+        checkpoints.pop_back();
+    }
+
+    if (!checkpoints.empty())
+    {
+        start = checkpoints.back().event;
+        offset = checkpoints.back().offset;
+        checkpoints.pop_back();
+    }
+
+    uint64_t tick = (start > 0) ? ticks[start - 1] : 0;
+
+    ticks.resize(events.size());
+
+    for (size_t i = start; i < events.size(); ++i)
+    {
+        tick += events[i].dt.get_data();
+        ticks[i] = tick;
+
+        if ((i % CHECKPOINT_INTERVAL) == 0)
+        {
+            // as in `event_size`, meta and sysex events reset running status
+            uint8_t running_status = 0;
+
+            if ((i > 0) && (events[i - 1].length > 0) && (STATUS_TABLE[events[i - 1].status].type != STATUS_CLASS::META) &&
+                (STATUS_TABLE[events[i - 1].status].type != STATUS_CLASS::SYSEX))
+            {
+                running_status = events[i - 1].status;
+            }
+
+            checkpoints.push_back({i, tick, offset, running_status});
+        }
+
+        offset += event_size(i);
+    }
+
+    indexed = events.size();
+}
+
+size_t MTrk_Chunk::seek(uint64_t tick)
+{
+    update_index();
+
+    return (size_t)(std::lower_bound(ticks.begin(), ticks.end(), tick) - ticks.begin());
+}
+
+uint64_t MTrk_Chunk::get_tick(size_t index)
+{
+    update_index();
+
+    if (index >= ticks.size())
+    {
+        // past the last event: the end of the track
+        return ticks.empty() ? 0 : ticks.back();
+    }
+
+    return ticks[index];
+}
+
+MTrk_Checkpoint MTrk_Chunk::get_checkpoint(size_t index)
+{
+    update_index();
+
+    if (checkpoints.empty())
+    {
+        return MTrk_Checkpoint{};
+    }
+
+    return checkpoints[std::min(index / CHECKPOINT_INTERVAL, checkpoints.size() - 1)];
+}
+
+void MTrk_Chunk::drop_index()
+{
+    std::pmr::vector<uint64_t>(ticks.get_allocator()).swap(ticks);
+    std::pmr::vector<MTrk_Checkpoint>(checkpoints.get_allocator()).swap(checkpoints);
+    indexed = 0;
 }
 
 MTrk_Event& MTrk_Chunk::back()
@@ -243,26 +920,19 @@ MTrk_Event& MTrk_Chunk::front()
     return events.front();
 }
 
-std::list<MTrk_Event>::iterator MTrk_Chunk::begin()
+std::pmr::vector<MTrk_Event>::iterator MTrk_Chunk::begin()
 {
     return events.begin();
 }
 
-std::list<MTrk_Event>::iterator MTrk_Chunk::end()
+std::pmr::vector<MTrk_Event>::iterator MTrk_Chunk::end()
 {
     return events.end();
 }
 
 MTrk_Event& MTrk_Chunk::operator[](size_t index)
 {
-    std::_List_iterator<MTrk_Event> it = events.begin();
-    
-    for (size_t i = 0; i < index; ++i)
-    {
-        ++it;
-    }
-
-    return *it;
+    return events[index];
 }
 
 /* ****************************************************************************
@@ -273,10 +943,34 @@ UNkn_Chunk::UNkn_Chunk()
     header = 0x554E6B6E; /* magic consatnt for "UNkn" */
 }
 
+UNkn_Chunk::UNkn_Chunk(const allocator_type& alloc) :
+    bytes(alloc)
+{
+    header = 0x554E6B6E;
+}
+
+UNkn_Chunk::UNkn_Chunk(const UNkn_Chunk& other, const allocator_type& alloc) :
+    MIDI_Chunk(other),
+    bytes(other.bytes, alloc)
+{
+}
+
+UNkn_Chunk::UNkn_Chunk(UNkn_Chunk&& other, const allocator_type& alloc) :
+    MIDI_Chunk(other),
+    bytes(std::move(other.bytes), alloc)
+{
+}
+
 void UNkn_Chunk::set_len(uint32_t new_len)
 {
     len = new_len;
-    bytes = std::vector<uint8_t>();
+    bytes.clear();
+}
+
+void UNkn_Chunk::clear()
+{
+    header = 0x554E6B6E;
+    set_len(0);
 }
 
 void UNkn_Chunk::push_byte(uint8_t next_byte)
@@ -284,6 +978,11 @@ void UNkn_Chunk::push_byte(uint8_t next_byte)
     bytes.push_back(next_byte);
 }
 
+void UNkn_Chunk::push_bytes(const uint8_t* next_bytes, size_t count)
+{
+    bytes.insert(bytes.end(), next_bytes, next_bytes + count);
+}
+
 uint8_t UNkn_Chunk::operator[](size_t index)
 {
     return bytes[index];
@@ -292,9 +991,102 @@ uint8_t UNkn_Chunk::operator[](size_t index)
 /* ****************************************************************************
 *  MIDI_File
 *  ************************************************************************* */
+MIDI_File::MIDI_File(const allocator_type& alloc) :
+    hdr(alloc),
+    ordered_chunks(alloc),
+    mtrk_chunks(alloc),
+    unkn_chunks(alloc),
+    spare_mtrk_chunks(alloc),
+    spare_unkn_chunks(alloc)
+{
+}
+
+MIDI_File::MIDI_File(const MIDI_File& other) :
+    hdr(other.hdr)
+{
+    copy_chunks(other);
+}
+
+MIDI_File& MIDI_File::operator=(const MIDI_File& other)
+{
+    if (this != &other)
+    {
+        clear();
+        copy_chunks(other);
+    }
+
+    return *this;
+}
+
+MIDI_File& MIDI_File::operator=(MIDI_File&& other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+
+    if (get_allocator() != other.get_allocator())
+    {
+        // chunks cannot move to another resource without being copied
+        return *this = static_cast<const MIDI_File&>(other);
+    }
+
+    // list nodes change hands, so the pointers in `ordered_chunks` stay valid
+    hdr = std::move(other.hdr);
+    ordered_chunks = std::move(other.ordered_chunks);
+    mtrk_chunks = std::move(other.mtrk_chunks);
+    unkn_chunks = std::move(other.unkn_chunks);
+    spare_mtrk_chunks = std::move(other.spare_mtrk_chunks);
+    spare_unkn_chunks = std::move(other.spare_unkn_chunks);
+
+    return *this;
+}
+
+void MIDI_File::copy_chunks(const MIDI_File& other)
+{
+    // `ordered_chunks` of a copy must point to its own chunks
+    MIDI_File& src = const_cast<MIDI_File&>(other);
+
+    for (MIDI_Chunk* chunk : src.ordered_chunks)
+    {
+        if (chunk->get_header() == CHUNK_HEADER::MTRK)
+        {
+            emplace_back_mtrk() = *static_cast<MTrk_Chunk*>(chunk);
+        }
+        else
+        {
+            emplace_back_unkn() = *static_cast<UNkn_Chunk*>(chunk);
+        }
+    }
+
+    hdr = src.hdr;
+}
+
+std::pmr::list<MTrk_Chunk>::iterator MIDI_File::new_mtrk(std::pmr::list<MTrk_Chunk>::iterator position)
+{
+    if (spare_mtrk_chunks.empty())
+    {
+        return mtrk_chunks.emplace(position);
+    }
+
+    mtrk_chunks.splice(position, spare_mtrk_chunks, spare_mtrk_chunks.begin());
+    return std::prev(position);
+}
+
+std::pmr::list<UNkn_Chunk>::iterator MIDI_File::new_unkn(std::pmr::list<UNkn_Chunk>::iterator position)
+{
+    if (spare_unkn_chunks.empty())
+    {
+        return unkn_chunks.emplace(position);
+    }
+
+    unkn_chunks.splice(position, spare_unkn_chunks, spare_unkn_chunks.begin());
+    return std::prev(position);
+}
+
 MTrk_Chunk& MIDI_File::emplace_back_mtrk()
 {
-    mtrk_chunks.emplace_back();
+    new_mtrk(mtrk_chunks.end());
     ordered_chunks.push_back(&mtrk_chunks.back());
 
     hdr.set_ntrks((uint16_t)ordered_chunks.size());
@@ -327,7 +1119,7 @@ MTrk_Chunk& MIDI_File::emplace_mtrk(size_t absolute_index)
         ++combined_index;
     }
 
-    mtrk_chunks.emplace(mtrk_index);
+    mtrk_index = new_mtrk(mtrk_index);
     ordered_chunks.emplace(combined_index, &(*mtrk_index));
 
     hdr.set_ntrks((uint16_t)ordered_chunks.size());
@@ -360,7 +1152,8 @@ MTrk_Chunk& MIDI_File::insert_mtrk(size_t absolute_index, const MTrk_Chunk& new_
         ++combined_index;
     }
 
-    mtrk_chunks.emplace(mtrk_index, new_chunk);
+    mtrk_index = new_mtrk(mtrk_index);
+    *mtrk_index = new_chunk;
     ordered_chunks.emplace(combined_index, &(*mtrk_index));
 
     hdr.set_ntrks((uint16_t)ordered_chunks.size());
@@ -369,9 +1162,18 @@ MTrk_Chunk& MIDI_File::insert_mtrk(size_t absolute_index, const MTrk_Chunk& new_
 }
 
 
+MTrk_Chunk& MIDI_File::insert_mtrk(size_t absolute_index, MTrk_Chunk&& new_chunk)
+{
+    MTrk_Chunk& chunk = emplace_mtrk(absolute_index);
+
+    chunk = std::move(new_chunk);
+
+    return chunk;
+}
+
 UNkn_Chunk& MIDI_File::emplace_back_unkn()
 {
-    unkn_chunks.emplace_back();
+    new_unkn(unkn_chunks.end());
     ordered_chunks.push_back(&unkn_chunks.back());
 
     hdr.set_ntrks((uint16_t)ordered_chunks.size());
@@ -404,7 +1206,7 @@ UNkn_Chunk& MIDI_File::emplace_unkn(size_t absolute_index)
         ++combined_index;
     }
 
-    unkn_chunks.emplace(unkn_index);
+    unkn_index = new_unkn(unkn_index);
     ordered_chunks.emplace(combined_index, &(*unkn_index));
 
     hdr.set_ntrks((uint16_t)ordered_chunks.size());
@@ -437,7 +1239,8 @@ UNkn_Chunk& MIDI_File::insert_unkn(size_t absolute_index, const UNkn_Chunk& new_
         ++combined_index;
     }
 
-    unkn_chunks.emplace(unkn_index, new_chunk);
+    unkn_index = new_unkn(unkn_index);
+    *unkn_index = new_chunk;
     ordered_chunks.emplace(combined_index, &(*unkn_index));
 
     hdr.set_ntrks((uint16_t)ordered_chunks.size());
@@ -445,6 +1248,15 @@ UNkn_Chunk& MIDI_File::insert_unkn(size_t absolute_index, const UNkn_Chunk& new_
     return *unkn_index;
 }
 
+UNkn_Chunk& MIDI_File::insert_unkn(size_t absolute_index, UNkn_Chunk&& new_chunk)
+{
+    UNkn_Chunk& chunk = emplace_unkn(absolute_index);
+
+    chunk = std::move(new_chunk);
+
+    return chunk;
+}
+
 void MIDI_File::erase(size_t absolute_index)
 {
     auto combined_index = ordered_chunks.begin();
@@ -470,13 +1282,42 @@ void MIDI_File::erase(size_t absolute_index)
         ++combined_index;
     }
 
-    unkn_chunks.erase(unkn_index);
+    // the erased chunk is kept for reuse, as by `clear()`
+    if ((*combined_index)->get_header() == CHUNK_HEADER::MTRK)
+    {
+        mtrk_index->clear();
+        spare_mtrk_chunks.splice(spare_mtrk_chunks.begin(), mtrk_chunks, mtrk_index);
+    }
+    else
+    {
+        unkn_index->clear();
+        spare_unkn_chunks.splice(spare_unkn_chunks.begin(), unkn_chunks, unkn_index);
+    }
+
     ordered_chunks.erase(combined_index);
 
     hdr.set_ntrks((uint16_t)ordered_chunks.size());
     
 }
 
+void MIDI_File::clear()
+{
+    for (MTrk_Chunk& chunk : mtrk_chunks)
+    {
+        chunk.clear();
+    }
+
+    for (UNkn_Chunk& chunk : unkn_chunks)
+    {
+        chunk.clear();
+    }
+
+    spare_mtrk_chunks.splice(spare_mtrk_chunks.begin(), mtrk_chunks); // the next file takes them back in the same order
+    spare_unkn_chunks.splice(spare_unkn_chunks.begin(), unkn_chunks);
+    ordered_chunks.clear();
+    hdr.clear();
+}
+
 MThd_Chunk& MIDI_File::get_hdr()
 {
     return hdr;
@@ -1,4 +1,54 @@
 #include "MIDI_Decoder.h"
+#include "MIDI_Scanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifdef MIDI_STATS
+#include <chrono>
+#endif
+
+/* ****************************************************************************
+ *  Buffer helpers (bulk decoding)
+ *  ************************************************************************* */
+static inline uint32_t read_u32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint16_t read_u16(const uint8_t* p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]);
+}
+
+static inline bool read_varlen(const uint8_t*& p, const uint8_t* end, uint32_t& value)
+{
+    // same limits as Varlen_Decoder: at most 4 bytes, last byte has bit 7 clear
+    int count = Varlen::decode(p, end, value);
+
+    p += count;
+
+    return (count > 0);
+}
+
+#ifdef MIDI_STATS
+static inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static inline void count_capacity(MIDI_Stats& stats, size_t& seen, size_t capacity)
+{
+    if (capacity > seen)
+    {
+        ++stats.allocations;
+    }
+
+    seen = capacity;
+}
+#endif
 
 /* ****************************************************************************
  *  MIDI_Element
@@ -11,7 +61,12 @@ void MIDI_Element_Decoder::clear()
 /* ****************************************************************************
  *  Var_Len
  *  ************************************************************************* */
-MIDI_Element_Decoder::STATUS Varlen_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data)
+MIDI_Element_Decoder::STATUS Varlen_Decoder::decode_byte(uint8_t next_byte, MIDI_Element*)
+{
+    return decode_byte(next_byte);
+}
+
+MIDI_Element_Decoder::STATUS Varlen_Decoder::decode_byte(uint8_t next_byte)
 {
     ++index;
 
@@ -61,7 +116,12 @@ void Varlen_Decoder::clear()
 /* ****************************************************************************
  *  Len
  *  ************************************************************************* */
-MIDI_Element_Decoder::STATUS Chunk_Length_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data)
+MIDI_Element_Decoder::STATUS Chunk_Length_Decoder::decode_byte(uint8_t next_byte, MIDI_Element*)
+{
+    return decode_byte(next_byte);
+}
+
+MIDI_Element_Decoder::STATUS Chunk_Length_Decoder::decode_byte(uint8_t next_byte)
 {
     ++index;
 
@@ -110,143 +170,25 @@ void Chunk_Length_Decoder::clear()
 /* ****************************************************************************
  *  MIDI_Event
  *  ************************************************************************* */
-MIDI_Element_Decoder::STATUS MIDI_Event_Decoder::set_type(uint8_t new_running_status)
+MIDI_Element_Decoder::STATUS MIDI_Event_Decoder::get_parameter_count(uint8_t new_running_status, uint8_t& count)
 {
-    // Channel Voice Messages
-    switch (new_running_status & 0b11110000)
-    {
-        case STATUS_BYTE::NOTE_OFF:
-        {
-            parameter_count = 2;
-            break;
-        }
-        case STATUS_BYTE::NOTE_ON:
-        {
-            parameter_count = 2;
-            break;
-        }
-        case STATUS_BYTE::AFTERTOUCH:
-        {
-            parameter_count = 2;
-            break;
-        }
-        case STATUS_BYTE::CONTROL_CHANGE:
-        {
-            parameter_count = 2;
-            break;
-        }
-        case STATUS_BYTE::PATCH_CHANGE:
-        {
-            parameter_count = 1;
-            break;
-        }
-        case STATUS_BYTE::CHANNEL_PRESSURE:
-        {
-            parameter_count = 1;
-            break;
-        }
-        case STATUS_BYTE::PITCH_BEND:
-        {
-            parameter_count = 2;
-            break;
-        }
-        default:
-        {
-            return STATUS::FAIL;
-        }
-    }
+    // Channel Voice Messages only: system messages are not accepted in an MTrk chunk
+    const Status_Info& info = STATUS_TABLE[new_running_status];
 
-    // System Messages
-    if ((new_running_status & 0xF0) == 0xF0)
+    if (info.type != STATUS_CLASS::CHANNEL)
     {
-        switch (new_running_status)
-        {
-            case STATUS_BYTE::META:
-            {
-                return STATUS::FAIL;
-            }
-            case STATUS_BYTE::SYSEX_F0:
-            {
-                return STATUS::FAIL;
-            }
-            case STATUS_BYTE::SYSEX_F7:
-            {
-                return STATUS::FAIL;
-            }
-            case 0xF1: // undefined
-            {
-                parameter_count = 0;
-                break;
-            }
-            case STATUS_BYTE::SONG_POSITION:
-            {
-                parameter_count = 2;
-                break;
-            }
-            case STATUS_BYTE::SONG_SELECT:
-            {
-                parameter_count = 1;
-                break;
-            }
-            case 0xF4: // undefined
-            {
-                parameter_count = 0;
-                break;
-            }
-            case 0xF5: // undefined
-            {
-                parameter_count = 0;
-                break;
-            }
-            case STATUS_BYTE::TUNE_REQUEST:
-            {
-                parameter_count = 0;
-                break;
-            }
-            case STATUS_BYTE::CLOCK:
-            {
-                parameter_count = 0;
-                break;
-            }
-            case 0xF9: // undefined
-            {
-                parameter_count = 0;
-                break;
-            }
-            case STATUS_BYTE::START:
-            {
-                parameter_count = 0;
-                break;
-            }
-            case STATUS_BYTE::CONTINUE:
-            {
-                parameter_count = 0;
-                break;
-            }
-            case STATUS_BYTE::STOP:
-            {
-                parameter_count = 0;
-                break;
-            }
-            case 0xFD: // undefined
-            {
-                parameter_count = 0;
-                break;
-            }
-            case STATUS_BYTE::ACTIVE_SENSING:
-            {
-                parameter_count = 0;
-                break;
-            }
-            default:
-            {
-                return STATUS::FAIL;
-            }
-        }
+        return STATUS::FAIL;
     }
+
+    count = info.parameter_count;
     return STATUS::SUCCESS;
 }
 
+MIDI_Element_Decoder::STATUS MIDI_Event_Decoder::set_type(uint8_t new_running_status)
+{
+    return get_parameter_count(new_running_status, parameter_count);
+}
+
 MIDI_Element_Decoder::STATUS MIDI_Event_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data)
 {
     if (data == nullptr)
@@ -255,8 +197,11 @@ MIDI_Element_Decoder::STATUS MIDI_Event_Decoder::decode_byte(uint8_t next_byte,
         return STATUS::FAIL;
     }
 
-    MTrk_Event& product = static_cast<MTrk_Event&>(*data);
+    return decode_byte(next_byte, static_cast<MTrk_Event&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS MIDI_Event_Decoder::decode_byte(uint8_t next_byte, MTrk_Event& product)
+{
     ++index;
 
     switch (current_state)
@@ -326,8 +271,11 @@ MIDI_Element_Decoder::STATUS Meta_Event_Decoder::decode_byte(uint8_t next_byte,
         return STATUS::FAIL;
     }
 
-    MTrk_Event& product = static_cast<MTrk_Event&>(*data);
+    return decode_byte(next_byte, static_cast<MTrk_Event&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS Meta_Event_Decoder::decode_byte(uint8_t next_byte, MTrk_Event& product)
+{
     ++index;
 
     switch (current_state)
@@ -355,7 +303,7 @@ MIDI_Element_Decoder::STATUS Meta_Event_Decoder::decode_byte(uint8_t next_byte,
         case STATE::LEN:
         {
             product.push_byte(next_byte);
-            current_status = len_decoder.decode_byte(next_byte, nullptr);
+            current_status = len_decoder.decode_byte(next_byte);
             switch (current_status)
             {
                 case STATUS::STANDBY:
@@ -437,8 +385,11 @@ MIDI_Element_Decoder::STATUS Sysex_Event_Decoder::decode_byte(uint8_t next_byte,
         return STATUS::FAIL;
     }
 
-    MTrk_Event& product = static_cast<MTrk_Event&>(*data);
+    return decode_byte(next_byte, static_cast<MTrk_Event&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS Sysex_Event_Decoder::decode_byte(uint8_t next_byte, MTrk_Event& product)
+{
     ++index;
 
     switch (current_state)
@@ -466,7 +417,7 @@ MIDI_Element_Decoder::STATUS Sysex_Event_Decoder::decode_byte(uint8_t next_byte,
             if a status byte is encountered before F7 then listening devices will 
             assume a new event */
 
-            current_status = varlen_decoder.decode_byte(next_byte, nullptr); // varlen not stored in payload bytes
+            current_status = varlen_decoder.decode_byte(next_byte); // varlen not stored in payload bytes
 
             switch (current_status)
             {
@@ -550,15 +501,65 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
         return STATUS::FAIL;
     }
 
-    MTrk_Chunk& product = static_cast<MTrk_Chunk&>(*data);
+    return decode_byte(next_byte, static_cast<MTrk_Chunk&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte, MTrk_Chunk& product)
+{
     ++index;
 
+    // The first byte of an event picks its decoder, which then receives that
+    // same byte below.
+    if (current_state == STATE::MESSAGE_TYPE)
+    {
+        switch (STATUS_TABLE[next_byte].type)
+        {
+            case STATUS_CLASS::META:
+            {
+                current_state = STATE::META;
+                meta_decoder.clear();
+                break;
+            }
+            case STATUS_CLASS::SYSEX:
+            {
+                current_state = STATE::SYSEX;
+                sysex_decoder.clear();
+                break;
+            }
+            case STATUS_CLASS::DATA:
+            {
+                // using current running status
+                current_state = STATE::MIDI;
+                midi_decoder.clear();
+#ifdef MIDI_STATS
+                if (stats != nullptr)
+                {
+                    ++stats->running_status;
+                }
+#endif
+
+                if (midi_decoder.decode_byte(running_status, product.back()) == STATUS::FAIL)
+                {
+                    current_state = STATE::FAIL;
+                    return STATUS::FAIL;
+                }
+                break;
+            }
+            default: // Default to MIDI if not Meta or Sysex, setting new running_status
+            {
+                current_state = STATE::MIDI;
+                running_status = next_byte;
+                midi_decoder.clear();
+                break;
+            }
+        }
+    }
+
     switch (current_state)
     {
         case STATE::DT:
         {
-            current_status = varlen_decoder.decode_byte(next_byte, nullptr);
+            current_status = varlen_decoder.decode_byte(next_byte);
 
             switch (current_status)
             {
@@ -571,6 +572,12 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
                     product.emplace_back_event();
                     product.back().set_dt(varlen_decoder.get());
                     current_state = STATE::MESSAGE_TYPE;
+#ifdef MIDI_STATS
+                    if (stats != nullptr)
+                    {
+                        ++stats->dt_varlen[varlen_decoder.get_index()];
+                    }
+#endif
                     break;
                 }
                 case STATUS::FAIL:
@@ -581,43 +588,13 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
             }
             break;
         }
-        case STATE::MESSAGE_TYPE:
+        case STATE::MESSAGE_TYPE: // resolved above
         {
-            if (next_byte == STATUS_BYTE::META)
-            {
-                current_state = STATE::META;
-                meta_decoder.clear();
-                return decode_byte(next_byte, &product); // RECURSION
-            }
-            else if ((next_byte == STATUS_BYTE::SYSEX_F0) || (next_byte == STATUS_BYTE::SYSEX_F7))
-            {
-                current_state = STATE::SYSEX;
-                sysex_decoder.clear();
-                return decode_byte(next_byte, &product); // RECURSION
-            }
-            else // Default to MIDI if not Meta or Sysex
-            {
-                current_state = STATE::MIDI;
-
-                if (next_byte & 0b10000000) // setting new running_status
-                {
-                    running_status = next_byte;
-                    midi_decoder.clear();
-                    return decode_byte(next_byte, &product); // RECURSION
-                }
-                else
-                {
-                    // using current running status
-                    midi_decoder.clear();
-                    decode_byte(running_status, &product);
-                    return decode_byte(next_byte, &product); // RECURSION
-                }
-            }
             break;
         }
         case STATE::META:
         {
-            current_status = meta_decoder.decode_byte(next_byte, &(product.back()));
+            current_status = meta_decoder.decode_byte(next_byte, product.back());
             switch (current_status)
             {
                 case STATUS::STANDBY:
@@ -626,6 +603,13 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
                 }
                 case STATUS::SUCCESS:
                 {
+#ifdef MIDI_STATS
+                    if (stats != nullptr)
+                    {
+                        ++stats->meta_events;
+                        ++stats->length_varlen[meta_decoder.get_len_size()];
+                    }
+#endif
                     current_state = STATE::DT;
                     varlen_decoder.clear();
                     return STATUS::SUCCESS;
@@ -641,7 +625,7 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
         }
         case STATE::SYSEX:
         {
-            current_status = sysex_decoder.decode_byte(next_byte, &(product.back()));
+            current_status = sysex_decoder.decode_byte(next_byte, product.back());
             switch (current_status)
             {
                 case STATUS::STANDBY:
@@ -650,6 +634,13 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
                 }
                 case STATUS::SUCCESS:
                 {
+#ifdef MIDI_STATS
+                    if (stats != nullptr)
+                    {
+                        ++stats->sysex_events;
+                        ++stats->length_varlen[sysex_decoder.get_len_size()];
+                    }
+#endif
                     current_state = STATE::DT;
                     varlen_decoder.clear();
                     return STATUS::SUCCESS;
@@ -664,7 +655,7 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
         }
         case STATE::MIDI:
         {
-            current_status = midi_decoder.decode_byte(next_byte, &(product.back()));
+            current_status = midi_decoder.decode_byte(next_byte, product.back());
             switch (current_status)
             {
                 case STATUS::STANDBY:
@@ -673,6 +664,12 @@ MIDI_Element_Decoder::STATUS MTrk_Events_Decoder::decode_byte(uint8_t next_byte,
                 }
                 case STATUS::SUCCESS:
                 {
+#ifdef MIDI_STATS
+                    if (stats != nullptr)
+                    {
+                        ++stats->channel_events;
+                    }
+#endif
                     current_state = STATE::DT;
                     varlen_decoder.clear();
                     return STATUS::SUCCESS;
@@ -715,7 +712,12 @@ void MTrk_Events_Decoder::clear()
 /* ****************************************************************************
  *  Chunk_Type
  *  ************************************************************************* */
-MIDI_Element_Decoder::STATUS Chunk_Type_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data)
+MIDI_Element_Decoder::STATUS Chunk_Type_Decoder::decode_byte(uint8_t next_byte, MIDI_Element*)
+{
+    return decode_byte(next_byte);
+}
+
+MIDI_Element_Decoder::STATUS Chunk_Type_Decoder::decode_byte(uint8_t next_byte)
 {
     ++index;
 
@@ -795,15 +797,18 @@ MIDI_Element_Decoder::STATUS UNkn_Chunk_Decoder::decode_byte(uint8_t next_byte,
         return STATUS::FAIL;
     }
 
-    UNkn_Chunk& product = static_cast<UNkn_Chunk&>(*data);
+    return decode_byte(next_byte, static_cast<UNkn_Chunk&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS UNkn_Chunk_Decoder::decode_byte(uint8_t next_byte, UNkn_Chunk& product)
+{
     ++index;
 
     switch (current_state)
     {
         case STATE::CHUNK_LEN:
         {
-            current_status = chunk_len_decoder.decode_byte(next_byte, nullptr);
+            current_status = chunk_len_decoder.decode_byte(next_byte);
             switch (current_status)
             {
                 case STATUS::STANDBY:
@@ -869,6 +874,15 @@ void UNkn_Chunk_Decoder::clear()
     current_status = STATUS::STANDBY;
 }
 
+MIDI_Element_Decoder::STATUS UNkn_Chunk_Decoder::decode(const uint8_t* body, uint32_t len, UNkn_Chunk& product)
+{
+    product.set_len(len);
+    product.push_bytes(body, len);
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
 MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data)
 {
     if (data == nullptr)
@@ -877,15 +891,18 @@ MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode_byte(uint8_t next_byte,
         return STATUS::FAIL;
     }
 
-    MTrk_Chunk& product = static_cast<MTrk_Chunk&>(*data);
+    return decode_byte(next_byte, static_cast<MTrk_Chunk&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode_byte(uint8_t next_byte, MTrk_Chunk& product)
+{
     ++index;
 
     switch (current_state)
     {
         case STATE::CHUNK_LEN:
         {
-            current_status = chunk_len_decoder.decode_byte(next_byte, nullptr);
+            current_status = chunk_len_decoder.decode_byte(next_byte);
             switch (current_status)
             {
                 case STATUS::STANDBY:
@@ -894,7 +911,7 @@ MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode_byte(uint8_t next_byte,
                 }
                 case STATUS::SUCCESS:
                 {
-                    product.set_len(chunk_len_decoder.get_len());
+                    // `product` length follows the events it receives
                     current_state = STATE::EVENTS;
                     break;
                 }
@@ -908,11 +925,11 @@ MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode_byte(uint8_t next_byte,
         }
         case STATE::EVENTS:
         {
-            if ((index - 4) < product.get_len())
+            if ((index - 4) < chunk_len_decoder.get_len())
             {
                 len_status = STATUS::STANDBY;
             }
-            else if ((index - 4) == product.get_len())
+            else if ((index - 4) == chunk_len_decoder.get_len())
             {
                 len_status = STATUS::SUCCESS;
             }
@@ -927,13 +944,13 @@ MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode_byte(uint8_t next_byte,
             {
                 case STATUS::STANDBY:
                 {
-                    current_status = event_decoder.decode_byte(next_byte, &product);
+                    current_status = event_decoder.decode_byte(next_byte, product);
 
                     break;
                 }
                 case STATUS::SUCCESS:
                 {
-                    current_status = event_decoder.decode_byte(next_byte, &product);
+                    current_status = event_decoder.decode_byte(next_byte, product);
 
                     // last byte in chunk must coincide
                     // with last byte of last event
@@ -981,73 +998,337 @@ void MTrk_Chunk_Decoder::clear()
     current_status = STATUS::STANDBY;
 }
 
-MIDI_Element_Decoder::STATUS MThd_Param_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data)
+MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode(const uint8_t* body, uint32_t len, MTrk_Chunk& product)
 {
-    return STATUS::FAIL;
+    // channel messages are 3-4 bytes with their delta time and kept inline
+    return decode(body, len, product, std::min<size_t>(len / 3, (size_t)MAX_RESERVED_EVENTS), 0);
 }
 
-MIDI_Element_Decoder::STATUS MThd_Param_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data, MTHD_PARAM cur_param)
+MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode(const uint8_t* body, uint32_t len, MTrk_Chunk& product,
+                                                        size_t event_count, size_t byte_count)
 {
-    if (data == nullptr)
+    /*
+    Same rules as `MTrk_Events_Decoder::decode_byte` applied directly to a
+    complete chunk body: the last byte of the chunk must be the last byte of
+    the last event.
+    */
+    const uint8_t* p = body;
+    const uint8_t* end = body + len;
+    uint8_t running_status = 0;
+    uint8_t parameter_count = 0;
+    uint32_t dt = 0;
+    uint32_t payload_len = 0;
+
+    if (len == 0)
     {
         current_state = STATE::FAIL;
         return STATUS::FAIL;
     }
 
-    MThd_Chunk& product = static_cast<MThd_Chunk&>(*data);
-    
-    ++index;
+#ifdef MIDI_STATS
+    size_t seen_capacity = product.get_capacity();
+    size_t seen_arena_capacity = product.get_arena_capacity();
+    const uint8_t* dt_start = p;
+#endif
 
-    switch (current_state)
+    product.reserve(event_count, byte_count);
+
+    while (p < end)
     {
-        case STATE::READ:
+#ifdef MIDI_STATS
+        if (stats != nullptr)
         {
-            if (index > 2)
+            count_capacity(*stats, seen_capacity, product.get_capacity());
+            count_capacity(*stats, seen_arena_capacity, product.get_arena_capacity());
+        }
+
+        dt_start = p;
+#endif
+
+        if (!read_varlen(p, end, dt) || (p == end))
+        {
+            current_state = STATE::FAIL;
+            return STATUS::FAIL;
+        }
+
+#ifdef MIDI_STATS
+        if (stats != nullptr)
+        {
+            ++stats->dt_varlen[p - dt_start];
+        }
+#endif
+
+        MTrk_Event& event = product.emplace_back_event();
+        event.set_dt(dt);
+
+        const uint8_t* start = p;
+        STATUS_CLASS type = STATUS_TABLE[*p].type;
+
+        if (type == STATUS_CLASS::META)
+        {
+            // FF, type, varlen length and payload are all stored in `bytes`
+            p += 1;
+
+            if (p == end)
             {
                 current_state = STATE::FAIL;
                 return STATUS::FAIL;
             }
-            else
+
+            p += 1;
+
+            if (!read_varlen(p, end, payload_len) || ((uint32_t)(end - p) < payload_len))
             {
-                param = (uint16_t)(param << 8) | (uint16_t)next_byte;
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
             }
 
-            if (index == 2)
+#ifdef MIDI_STATS
+            if (stats != nullptr)
             {
-                current_state = STATE::DONE;
-
-                switch (cur_param)
-                {
-                    case MTHD_PARAM::FMT:
-                    {
-                        product.set_fmt(param);
-                        break;
-                    }
-                    case MTHD_PARAM::NTRKS:
-                    {
-                        product.set_ntrks(param);
-                        break;
-                    }
-                    case MTHD_PARAM::DIV:
-                    {
-                        product.set_div(param);
-                        break;
-                    }
-                }
-
-                return STATUS::SUCCESS;
+                ++stats->meta_events;
+                ++stats->length_varlen[p - start - 2];
             }
+#endif
 
-            break;
-        }
-        case STATE::DONE:
-        {
-            return STATUS::FAIL;
+            p += payload_len;
+            event.push_bytes(start, (size_t)(p - start));
         }
-        case STATE::FAIL:
+        else if (type == STATUS_CLASS::SYSEX)
         {
-            return STATUS::FAIL;
-        }
+            // sysex length is not stored in `bytes`
+            p += 1;
+
+            if (!read_varlen(p, end, payload_len) || ((uint32_t)(end - p) < payload_len))
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+
+            for (uint32_t i = 0; i < payload_len; ++i)
+            {
+                if ((p[i] & 0b10000000) && (p[i] != STATUS_BYTE::SYSEX_F7))
+                {
+                    current_state = STATE::FAIL;
+                    return STATUS::FAIL;
+                }
+            }
+
+#ifdef MIDI_STATS
+            if (stats != nullptr)
+            {
+                ++stats->sysex_events;
+                ++stats->length_varlen[p - start - 1];
+            }
+#endif
+
+            event.push_byte(*start);
+            event.push_bytes(p, payload_len);
+            p += payload_len;
+        }
+        else
+        {
+            if (type != STATUS_CLASS::DATA) // setting new running_status
+            {
+                running_status = *p;
+                p += 1;
+            }
+
+            const Status_Info& info = STATUS_TABLE[running_status];
+            parameter_count = info.parameter_count;
+
+            if ((info.type != STATUS_CLASS::CHANNEL) || ((size_t)(end - p) < parameter_count))
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+
+#ifdef MIDI_STATS
+            if (stats != nullptr)
+            {
+                ++stats->channel_events;
+                stats->running_status += (start == p);
+            }
+#endif
+
+            event.push_byte(running_status);
+            event.push_bytes(p, parameter_count);
+            p += parameter_count;
+        }
+    }
+
+#ifdef MIDI_STATS
+    if (stats != nullptr)
+    {
+        count_capacity(*stats, seen_capacity, product.get_capacity());
+        count_capacity(*stats, seen_arena_capacity, product.get_arena_capacity());
+    }
+#endif
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Decoder::STATUS MTrk_Chunk_Decoder::decode(const uint8_t* body, uint32_t len, std::vector<Channel_Event>& product)
+{
+    const uint8_t* p = body;
+    const uint8_t* end = body + len;
+    uint8_t running_status = 0;
+    uint32_t tick = 0;
+    uint32_t dt = 0;
+    uint32_t payload_len = 0;
+
+    if (len == 0)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    product.reserve(product.size() + std::min<size_t>(len / 3, (size_t)MAX_RESERVED_EVENTS));
+
+    while (p < end)
+    {
+        if (!read_varlen(p, end, dt) || (p == end))
+        {
+            current_state = STATE::FAIL;
+            return STATUS::FAIL;
+        }
+
+        tick += dt;
+        STATUS_CLASS type = STATUS_TABLE[*p].type;
+
+        if (type == STATUS_CLASS::META)
+        {
+            p += 1;
+
+            if (p == end)
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+
+            p += 1;
+
+            if (!read_varlen(p, end, payload_len) || ((uint32_t)(end - p) < payload_len))
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+
+            p += payload_len;
+        }
+        else if (type == STATUS_CLASS::SYSEX)
+        {
+            p += 1;
+
+            if (!read_varlen(p, end, payload_len) || ((uint32_t)(end - p) < payload_len))
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+
+            for (uint32_t i = 0; i < payload_len; ++i)
+            {
+                if ((p[i] & 0b10000000) && (p[i] != STATUS_BYTE::SYSEX_F7))
+                {
+                    current_state = STATE::FAIL;
+                    return STATUS::FAIL;
+                }
+            }
+
+            p += payload_len;
+        }
+        else
+        {
+            if (type != STATUS_CLASS::DATA) // setting new running_status
+            {
+                running_status = *p;
+                p += 1;
+            }
+
+            const Status_Info& info = STATUS_TABLE[running_status];
+
+            if ((info.type != STATUS_CLASS::CHANNEL) || ((size_t)(end - p) < info.parameter_count))
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+
+            Channel_Event event{tick, running_status, p[0], 0, 0};
+
+            if (info.parameter_count == 2)
+            {
+                event.data2 = p[1];
+            }
+
+            product.push_back(event);
+            p += info.parameter_count;
+        }
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Decoder::STATUS MThd_Param_Decoder::decode_byte(uint8_t next_byte, MIDI_Element* data)
+{
+    return STATUS::FAIL;
+}
+
+MIDI_Element_Decoder::STATUS MThd_Param_Decoder::decode_byte(uint8_t next_byte, MThd_Chunk& product, MTHD_PARAM cur_param)
+{
+    ++index;
+
+    switch (current_state)
+    {
+        case STATE::READ:
+        {
+            if (index > 2)
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+            else
+            {
+                param = (uint16_t)(param << 8) | (uint16_t)next_byte;
+            }
+
+            if (index == 2)
+            {
+                current_state = STATE::DONE;
+
+                switch (cur_param)
+                {
+                    case MTHD_PARAM::FMT:
+                    {
+                        product.set_fmt(param);
+                        break;
+                    }
+                    case MTHD_PARAM::NTRKS:
+                    {
+                        product.set_ntrks(param);
+                        break;
+                    }
+                    case MTHD_PARAM::DIV:
+                    {
+                        product.set_div(param);
+                        break;
+                    }
+                }
+
+                return STATUS::SUCCESS;
+            }
+
+            break;
+        }
+        case STATE::DONE:
+        {
+            return STATUS::FAIL;
+        }
+        case STATE::FAIL:
+        {
+            return STATUS::FAIL;
+        }
     }
 
     return STATUS::STANDBY;
@@ -1079,8 +1360,11 @@ MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte,
         return STATUS::FAIL;
     }
 
-    MThd_Chunk& product = static_cast<MThd_Chunk&>(*data);
+    return decode_byte(next_byte, static_cast<MThd_Chunk&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte, MThd_Chunk& product)
+{
     ++index;
 
     switch (current_state)
@@ -1093,7 +1377,7 @@ MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte,
                 return STATUS::FAIL;
             }
 
-            current_status = mthd_len_decoder.decode_byte(next_byte, nullptr);
+            current_status = mthd_len_decoder.decode_byte(next_byte);
 
             switch (current_status)
             {
@@ -1105,6 +1389,12 @@ MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte,
                 {
                     product.set_len(mthd_len_decoder.get_len());
 
+                    if (product.get_len() < 6) // too short for fmt, ntrks and div
+                    {
+                        current_state = STATE::FAIL;
+                        return STATUS::FAIL;
+                    }
+
                     if (product.get_len() > 6)
                     {
                         extended_last = 7 + product.get_len();
@@ -1130,7 +1420,7 @@ MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte,
                 return STATUS::FAIL;
             }
 
-            current_status = mthd_param_decoder.decode_byte(next_byte, &product, MThd_Param_Decoder::MTHD_PARAM::FMT);
+            current_status = mthd_param_decoder.decode_byte(next_byte, product, MThd_Param_Decoder::MTHD_PARAM::FMT);
 
             switch (current_status)
             {
@@ -1162,7 +1452,7 @@ MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte,
                 return STATUS::FAIL;
             }
 
-            current_status = mthd_param_decoder.decode_byte(next_byte, &product, MThd_Param_Decoder::MTHD_PARAM::NTRKS);
+            current_status = mthd_param_decoder.decode_byte(next_byte, product, MThd_Param_Decoder::MTHD_PARAM::NTRKS);
 
             switch (current_status)
             {
@@ -1194,7 +1484,7 @@ MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte,
                 return STATUS::FAIL;
             }
 
-            current_status = mthd_param_decoder.decode_byte(next_byte, &product, MThd_Param_Decoder::MTHD_PARAM::DIV);
+            current_status = mthd_param_decoder.decode_byte(next_byte, product, MThd_Param_Decoder::MTHD_PARAM::DIV);
 
             switch (current_status)
             {
@@ -1258,6 +1548,25 @@ MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode_byte(uint8_t next_byte,
     return STATUS::STANDBY;
 }
 
+MIDI_Element_Decoder::STATUS MThd_Chunk_Decoder::decode(const uint8_t* body, uint32_t len, MThd_Chunk& product)
+{
+    if (len < 6)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    product.set_len(len);
+    product.set_fmt(read_u16(body));
+    product.set_ntrks(read_u16(body + 2));
+    product.set_div(read_u16(body + 4));
+
+    product.push_bytes(body + 6, len - 6);
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
 /* ****************************************************************************
  *  File
  *  ************************************************************************* */
@@ -1269,15 +1578,37 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
         return STATUS::FAIL;
     }
 
-    MIDI_File& product = static_cast<MIDI_File&>(*data);
+    return decode_byte(next_byte, static_cast<MIDI_File&>(*data));
+}
 
+MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, MIDI_File& product)
+{
     ++index;
 
+#ifdef MIDI_STATS
+    switch (current_state)
+    {
+        case STATE::MTHD:
+        case STATE::MTRK:
+        case STATE::UNKN:
+        {
+            // bytes of the chunk tag are added once the tag is complete
+            count_growth(product);
+            count_chunk_bytes(1);
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+#endif
+
     switch (current_state)
     {
         case STATE::CHUNK_TYPE:
         {
-            current_status = chunk_type_decoder.decode_byte(next_byte, nullptr);
+            current_status = chunk_type_decoder.decode_byte(next_byte);
 
             switch (current_status)
             {
@@ -1311,6 +1642,12 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
                             break;
                         }
                     }
+
+#ifdef MIDI_STATS
+                    begin_chunk_stats(product, chunk_type_decoder.get_header());
+                    count_chunk_bytes(4);
+                    mtrk_decoder.set_stats(&stats);
+#endif
                     
                     break;
                 }
@@ -1324,7 +1661,7 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
         }
         case STATE::MTHD:
         {
-            current_status = mthd_decoder.decode_byte(next_byte, &(product.get_hdr()));
+            current_status = mthd_decoder.decode_byte(next_byte, product.get_hdr());
 
             switch (current_status)
             {
@@ -1335,6 +1672,9 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
                 case STATUS::SUCCESS:
                 {
                     expected_tracks = product.get_hdr().get_ntrks();
+#ifdef MIDI_STATS
+                    count_growth(product);
+#endif
 
                     if (expected_tracks > 0)
                     {
@@ -1358,7 +1698,7 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
         }
         case STATE::MTRK:
         {
-            current_status = mtrk_decoder.decode_byte(next_byte, &(static_cast<MTrk_Chunk &>(product[track_index])));
+            current_status = mtrk_decoder.decode_byte(next_byte, static_cast<MTrk_Chunk &>(product.get_chunk(track_index)));
 
             switch (current_status)
             {
@@ -1368,6 +1708,10 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
                 }
                 case STATUS::SUCCESS:
                 {
+#ifdef MIDI_STATS
+                    count_growth(product);
+                    stats.chunks.back().events = static_cast<MTrk_Chunk &>(product.get_chunk(track_index)).size();
+#endif
                     if ((uint16_t)track_index < (expected_tracks - 1))
                     {
                         current_state = STATE::CHUNK_TYPE;
@@ -1392,7 +1736,7 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
         }
         case STATE::UNKN:
         {
-            current_status = unkn_decoder.decode_byte(next_byte, &(static_cast<UNkn_Chunk &>(product.get_chunk(track_index))));
+            current_status = unkn_decoder.decode_byte(next_byte, static_cast<UNkn_Chunk &>(product.get_chunk(track_index)));
 
             switch (current_status)
             {
@@ -1402,6 +1746,9 @@ MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_byte(uint8_t next_byte, M
                 }
                 case STATUS::SUCCESS:
                 {
+#ifdef MIDI_STATS
+                    count_growth(product);
+#endif
                     if ((uint16_t)track_index < (expected_tracks - 1))
                     {
                         current_state = STATE::CHUNK_TYPE;
@@ -1446,5 +1793,791 @@ void MIDI_File_Decoder::clear()
     mthd_decoder.clear();
     current_status = STATUS::STANDBY;
     current_state = STATE::CHUNK_TYPE;
+    expected_tracks = 0;
     track_index = 0;
+#ifdef MIDI_STATS
+    stats.clear();
+#endif
+}
+
+#ifdef MIDI_STATS
+void MIDI_File_Decoder::begin_chunk_stats(MIDI_File& product, uint32_t header)
+{
+    // the chunk has just been created (or is the MThd chunk)
+    stats.chunks.push_back({header, 0, 0, 0});
+    seen_arena_capacity = 0;
+
+    switch (header)
+    {
+        case CHUNK_HEADER::MTHD:
+        {
+            seen_capacity = product.get_hdr().get_extended_capacity();
+            break;
+        }
+        case CHUNK_HEADER::MTRK:
+        {
+            MTrk_Chunk& chunk = static_cast<MTrk_Chunk&>(product.get_chunk(track_index));
+
+            seen_capacity = chunk.get_capacity();
+            seen_arena_capacity = chunk.get_arena_capacity();
+            break;
+        }
+        default:
+        {
+            seen_capacity = static_cast<UNkn_Chunk&>(product.get_chunk(track_index)).get_capacity();
+            break;
+        }
+    }
+}
+
+void MIDI_File_Decoder::count_chunk_bytes(uint64_t bytes)
+{
+    stats.chunks.back().bytes += bytes;
+
+    switch (stats.chunks.back().header)
+    {
+        case CHUNK_HEADER::MTHD:
+        {
+            stats.mthd_bytes += bytes;
+            break;
+        }
+        case CHUNK_HEADER::MTRK:
+        {
+            stats.mtrk_bytes += bytes;
+            break;
+        }
+        default:
+        {
+            stats.unkn_bytes += bytes;
+            break;
+        }
+    }
+}
+
+void MIDI_File_Decoder::count_growth(MIDI_File& product)
+{
+    switch (stats.chunks.back().header)
+    {
+        case CHUNK_HEADER::MTHD:
+        {
+            count_capacity(stats, seen_capacity, product.get_hdr().get_extended_capacity());
+            break;
+        }
+        case CHUNK_HEADER::MTRK:
+        {
+            MTrk_Chunk& chunk = static_cast<MTrk_Chunk&>(product.get_chunk(track_index));
+
+            count_capacity(stats, seen_capacity, chunk.get_capacity());
+            count_capacity(stats, seen_arena_capacity, chunk.get_arena_capacity());
+            break;
+        }
+        default:
+        {
+            count_capacity(stats, seen_capacity, static_cast<UNkn_Chunk&>(product.get_chunk(track_index)).get_capacity());
+            break;
+        }
+    }
+}
+#endif
+
+MIDI_Element_Decoder::STATUS MIDI_File_Decoder::next_chunk()
+{
+    if ((uint16_t)track_index < (expected_tracks - 1))
+    {
+        current_state = STATE::CHUNK_TYPE;
+        chunk_type_decoder.clear();
+        ++track_index;
+        return STATUS::STANDBY;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode(const uint8_t* data, size_t len, MIDI_File& product)
+{
+    size_t pos = 0;
+
+    while (pos < len)
+    {
+        switch (current_state)
+        {
+            case STATE::DONE:
+            {
+                return STATUS::SUCCESS;
+            }
+            case STATE::FAIL:
+            {
+                return STATUS::FAIL;
+            }
+            default:
+            {
+                break;
+            }
+        }
+
+        /*
+        Whole chunks are decoded straight from the buffer. Anything else (a
+        chunk that began in an earlier call or a chunk cut off by the end of
+        `data`) goes through the byte-at-a-time state machine.
+        */
+        bool at_boundary = (current_state == STATE::CHUNK_TYPE) && (chunk_type_decoder.get_index() == 0);
+        uint32_t header = 0;
+        uint32_t chunk_len = 0;
+
+        if (at_boundary && ((len - pos) >= 8))
+        {
+            header = read_u32(data + pos);
+            chunk_len = read_u32(data + pos + 4);
+        }
+
+        if (!at_boundary || ((len - pos) < 8) || ((uint64_t)chunk_len > (uint64_t)(len - pos - 8)))
+        {
+            current_status = decode_byte(data[pos], product);
+            ++pos;
+
+            if (current_status != STATUS::STANDBY)
+            {
+                return current_status;
+            }
+
+            continue;
+        }
+
+        const uint8_t* body = data + pos + 8;
+        pos += 8 + (size_t)chunk_len;
+        index += 8 + (size_t)chunk_len;
+
+#ifdef MIDI_STATS
+        auto start = std::chrono::steady_clock::now();
+#endif
+
+        switch (header)
+        {
+            case CHUNK_HEADER::MTHD:
+            {
+                mthd_decoder.clear();
+#ifdef MIDI_STATS
+                begin_chunk_stats(product, header);
+                count_chunk_bytes(8 + (uint64_t)chunk_len);
+#endif
+                current_status = mthd_decoder.decode(body, chunk_len, product.get_hdr());
+
+                if (current_status == STATUS::FAIL)
+                {
+                    current_state = STATE::FAIL;
+                    return STATUS::FAIL;
+                }
+
+#ifdef MIDI_STATS
+                count_growth(product);
+                stats.chunks.back().nanoseconds = elapsed_ns(start);
+#endif
+
+                expected_tracks = product.get_hdr().get_ntrks();
+
+                if (expected_tracks == 0)
+                {
+                    current_state = STATE::DONE;
+                    return STATUS::SUCCESS;
+                }
+
+                break;
+            }
+            case CHUNK_HEADER::MTRK:
+            {
+                mtrk_decoder.clear();
+#ifdef MIDI_STATS
+                MTrk_Chunk& chunk = product.emplace_back_mtrk();
+
+                begin_chunk_stats(product, header);
+                count_chunk_bytes(8 + (uint64_t)chunk_len);
+                mtrk_decoder.set_stats(&stats);
+                current_status = mtrk_decoder.decode(body, chunk_len, chunk); // counts its own growth
+                stats.chunks.back().events = chunk.size();
+                stats.chunks.back().nanoseconds = elapsed_ns(start);
+#else
+                current_status = mtrk_decoder.decode(body, chunk_len, product.emplace_back_mtrk());
+#endif
+
+                if (current_status == STATUS::FAIL)
+                {
+                    current_state = STATE::FAIL;
+                    return STATUS::FAIL;
+                }
+
+                if (next_chunk() == STATUS::SUCCESS)
+                {
+                    return STATUS::SUCCESS;
+                }
+
+                break;
+            }
+            default:
+            {
+                UNkn_Chunk& chunk = product.emplace_back_unkn();
+                chunk.set_header(header);
+
+#ifdef MIDI_STATS
+                begin_chunk_stats(product, header);
+                count_chunk_bytes(8 + (uint64_t)chunk_len);
+#endif
+                unkn_decoder.clear();
+                unkn_decoder.decode(body, chunk_len, chunk);
+#ifdef MIDI_STATS
+                count_growth(product);
+                stats.chunks.back().nanoseconds = elapsed_ns(start);
+#endif
+
+                if (next_chunk() == STATUS::SUCCESS)
+                {
+                    return STATUS::SUCCESS;
+                }
+
+                break;
+            }
+        }
+    }
+
+    switch (current_state)
+    {
+        case STATE::DONE:
+        {
+            return STATUS::SUCCESS;
+        }
+        case STATE::FAIL:
+        {
+            return STATUS::FAIL;
+        }
+        default:
+        {
+            return STATUS::STANDBY;
+        }
+    }
+}
+
+MIDI_Element_Decoder::STATUS MIDI_File_Decoder::decode_parallel(const uint8_t* data, size_t len, MIDI_File& product,
+                                                                unsigned thread_count)
+{
+    struct Track_Job
+    {
+        const uint8_t*  body;
+        uint32_t        len;
+        MTrk_Chunk*     chunk;
+#ifdef MIDI_STATS
+        size_t          stats_index;
+        MIDI_Stats      stats;
+        uint64_t        nanoseconds;
+#endif
+    };
+
+    MIDI_Scanner scanner{};
+
+    /*
+    Walk the chunk headers without decoding anything. Only a fresh decoder and a
+    buffer that starts with a complete MThd and holds every chunk it announces
+    take the parallel path.
+    */
+    if ((index != 0) || (current_state != STATE::CHUNK_TYPE) || (chunk_type_decoder.get_index() != 0) ||
+        (scanner.scan(data, len) == STATUS::FAIL))
+    {
+        return decode(data, len, product);
+    }
+
+    /*
+    Create every chunk in file order before any thread starts: `MIDI_File`
+    keeps chunks in lists, so the references handed to the workers stay valid.
+    UNkn chunks are only copied and are done here.
+    */
+    std::vector<Track_Job> jobs{};
+    MIDI_Chunk_Span& hdr = scanner.get_chunk(0);
+
+    mthd_decoder.clear();
+
+#ifdef MIDI_STATS
+    begin_chunk_stats(product, CHUNK_HEADER::MTHD);
+    count_chunk_bytes(8 + (uint64_t)hdr.len);
+#endif
+
+    if (mthd_decoder.decode(hdr.body, hdr.len, product.get_hdr()) == STATUS::FAIL)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+#ifdef MIDI_STATS
+    count_growth(product);
+#endif
+
+    expected_tracks = product.get_hdr().get_ntrks();
+
+    for (size_t i = 1; i < scanner.get_chunk_count(); ++i)
+    {
+        MIDI_Chunk_Span& chunk = scanner.get_chunk(i);
+
+        if (chunk.header == CHUNK_HEADER::MTRK)
+        {
+            jobs.push_back({chunk.body, chunk.len, &product.emplace_back_mtrk()});
+#ifdef MIDI_STATS
+            track_index = i - 1;
+            jobs.back().stats_index = stats.chunks.size();
+            begin_chunk_stats(product, chunk.header);
+            count_chunk_bytes(8 + (uint64_t)chunk.len);
+#endif
+        }
+        else
+        {
+            UNkn_Chunk& unkn = product.emplace_back_unkn();
+            unkn.set_header(chunk.header);
+
+#ifdef MIDI_STATS
+            auto start = std::chrono::steady_clock::now();
+            track_index = i - 1;
+            begin_chunk_stats(product, chunk.header);
+            count_chunk_bytes(8 + (uint64_t)chunk.len);
+#endif
+            unkn_decoder.clear();
+            unkn_decoder.decode(chunk.body, chunk.len, unkn);
+#ifdef MIDI_STATS
+            count_growth(product);
+            stats.chunks.back().nanoseconds = elapsed_ns(start);
+#endif
+        }
+    }
+
+    std::atomic<size_t> next_job{0};
+    std::atomic<bool> failed{false};
+
+    auto worker = [&jobs, &next_job, &failed]()
+    {
+        MTrk_Chunk_Decoder track_decoder{};
+
+        for (size_t i = next_job++; (i < jobs.size()) && !failed; i = next_job++)
+        {
+            track_decoder.clear();
+
+#ifdef MIDI_STATS
+            auto start = std::chrono::steady_clock::now();
+            track_decoder.set_stats(&jobs[i].stats);
+#endif
+
+            if (track_decoder.decode(jobs[i].body, jobs[i].len, *jobs[i].chunk) == STATUS::FAIL)
+            {
+                failed = true;
+            }
+
+#ifdef MIDI_STATS
+            jobs[i].nanoseconds = elapsed_ns(start);
+#endif
+        }
+    };
+
+    if (thread_count == 0)
+    {
+        thread_count = std::thread::hardware_concurrency();
+    }
+
+    size_t worker_count = std::min<size_t>(thread_count, jobs.size());
+    std::vector<std::thread> threads{};
+
+    for (size_t i = 1; i < worker_count; ++i) // the calling thread is the last worker
+    {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    index += scanner.get_size();
+    track_index = (scanner.get_chunk_count() > 1) ? (scanner.get_chunk_count() - 2) : 0;
+
+#ifdef MIDI_STATS
+    for (Track_Job& job : jobs)
+    {
+        stats.add_events(job.stats);
+        stats.chunks[job.stats_index].events = job.chunk->size();
+        stats.chunks[job.stats_index].nanoseconds = job.nanoseconds;
+    }
+#endif
+
+    if (failed)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+/* ****************************************************************************
+ *  Stream
+ *  ************************************************************************* */
+void MIDI_Stream_Decoder::clear()
+{
+    MIDI_Element_Decoder::clear();
+    current_state = STATE::CHUNK_HEAD;
+    head_used = 0;
+    chunk_remaining = 0;
+    in_file = false;
+    expected_chunks = 0;
+    chunk_count = 0;
+    track_index = 0;
+    file_count = 0;
+    hdr = MThd_Chunk();
+    event.clear();
+    running_status = 0;
+    varlen = 0;
+    varlen_bytes = 0;
+    remaining = 0;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Stream_Decoder::fail()
+{
+    current_state = STATE::FAIL;
+    return STATUS::FAIL;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Stream_Decoder::next_chunk()
+{
+    ++chunk_count;
+
+    if (chunk_count == expected_chunks)
+    {
+        in_file = false; // the next chunk must be the MThd chunk of another file
+    }
+
+    current_state = STATE::CHUNK_HEAD;
+    return STATUS::STANDBY;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Stream_Decoder::end_event()
+{
+    handler.on_event(event);
+    event.clear();
+
+    if (chunk_remaining > 0)
+    {
+        current_state = STATE::DT;
+        return STATUS::STANDBY;
+    }
+
+    handler.on_track_end(track_index);
+    ++track_index;
+
+    return next_chunk();
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Stream_Decoder::decode_byte(uint8_t next_byte, MIDI_Element*)
+{
+    return decode(&next_byte, 1);
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Stream_Decoder::decode(const uint8_t* data, size_t len)
+{
+    /*
+    Same rules as `MIDI_File_Decoder` and `MTrk_Events_Decoder`. Runs of payload
+    bytes and skipped chunks are consumed as far as the block allows; everything
+    else advances one byte per iteration.
+    */
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+    uint8_t next_byte = 0;
+
+    index += len;
+
+    while (p < end)
+    {
+        switch (current_state)
+        {
+            case STATE::CHUNK_HEAD:
+            {
+                size_t count = std::min<size_t>(8 - head_used, (size_t)(end - p));
+
+                std::copy(p, p + count, head + head_used);
+                head_used += count;
+                p += count;
+
+                if (head_used < 8)
+                {
+                    break;
+                }
+
+                uint32_t header = read_u32(head);
+                chunk_remaining = read_u32(head + 4);
+                head_used = 0;
+
+                if (!in_file)
+                {
+                    if ((header != CHUNK_HEADER::MTHD) || (chunk_remaining < 6))
+                    {
+                        return fail();
+                    }
+
+                    hdr = MThd_Chunk();
+                    hdr.set_len(chunk_remaining);
+                    current_state = STATE::MTHD;
+                }
+                else if (header == CHUNK_HEADER::MTRK)
+                {
+                    if (chunk_remaining == 0)
+                    {
+                        return fail();
+                    }
+
+                    handler.on_track_begin(track_index, chunk_remaining);
+                    running_status = 0;
+                    varlen = 0;
+                    varlen_bytes = 0;
+                    current_state = STATE::DT;
+                }
+                else
+                {
+                    handler.on_unknown_chunk(header, chunk_remaining);
+                    current_state = STATE::SKIP;
+
+                    if (chunk_remaining == 0)
+                    {
+                        next_chunk();
+                    }
+                }
+
+                break;
+            }
+            case STATE::MTHD:
+            {
+                next_byte = *p++;
+                --chunk_remaining;
+
+                if (head_used < 6) // fmt, ntrks and div are collected in `head`
+                {
+                    head[head_used++] = next_byte;
+
+                    if (head_used == 6)
+                    {
+                        hdr.set_fmt(read_u16(head));
+                        hdr.set_ntrks(read_u16(head + 2));
+                        hdr.set_div(read_u16(head + 4));
+                    }
+                }
+                else
+                {
+                    hdr.push_byte(next_byte);
+                }
+
+                if (chunk_remaining == 0)
+                {
+                    head_used = 0;
+                    ++file_count;
+                    expected_chunks = hdr.get_ntrks();
+                    chunk_count = 0;
+                    track_index = 0;
+                    in_file = (expected_chunks > 0);
+                    current_state = STATE::CHUNK_HEAD;
+
+                    handler.on_header(hdr);
+                }
+
+                break;
+            }
+            case STATE::DT:
+            {
+                if (varlen_bytes == 0)
+                {
+                    // whole delta time in this block and chunk: decode it in one step
+                    size_t limit = std::min<size_t>((size_t)(end - p), chunk_remaining);
+                    int count = Varlen::decode(p, p + limit, varlen);
+
+                    if (count > 0)
+                    {
+                        p += count;
+                        chunk_remaining -= (uint32_t)count;
+
+                        event.set_dt(varlen);
+                        varlen = 0;
+                        current_state = STATE::EVENT_TYPE;
+                        break;
+                    }
+                    else if (limit >= 4) // MIDI variable length elements <= 32-bits deep
+                    {
+                        return fail();
+                    }
+                }
+
+                next_byte = *p++;
+                --chunk_remaining;
+
+                varlen = (varlen << 7) | (next_byte & 0b01111111);
+                ++varlen_bytes;
+
+                if (next_byte & 0b10000000)
+                {
+                    if (varlen_bytes == 4) // MIDI variable length elements <= 32-bits deep
+                    {
+                        return fail();
+                    }
+
+                    break;
+                }
+
+                event.set_dt(varlen);
+                varlen = 0;
+                varlen_bytes = 0;
+                current_state = STATE::EVENT_TYPE;
+                break;
+            }
+            case STATE::EVENT_TYPE:
+            {
+                next_byte = *p;
+                STATUS_CLASS type = STATUS_TABLE[next_byte].type;
+
+                if (type == STATUS_CLASS::META)
+                {
+                    event.push_byte(next_byte);
+                    ++p;
+                    --chunk_remaining;
+                    current_state = STATE::META_TYPE;
+                }
+                else if (type == STATUS_CLASS::SYSEX)
+                {
+                    event.push_byte(next_byte);
+                    ++p;
+                    --chunk_remaining;
+                    current_state = STATE::LEN;
+                }
+                else
+                {
+                    if (type != STATUS_CLASS::DATA) // setting new running_status
+                    {
+                        running_status = next_byte;
+                        ++p;
+                        --chunk_remaining;
+                    }
+
+                    const Status_Info& info = STATUS_TABLE[running_status];
+
+                    if (info.type != STATUS_CLASS::CHANNEL)
+                    {
+                        return fail();
+                    }
+
+                    event.push_byte(running_status);
+                    remaining = info.parameter_count;
+                    current_state = STATE::PARAMETERS;
+                }
+
+                break;
+            }
+            case STATE::META_TYPE:
+            {
+                event.push_byte(*p++);
+                --chunk_remaining;
+                current_state = STATE::LEN;
+                break;
+            }
+            case STATE::LEN:
+            {
+                next_byte = *p++;
+                --chunk_remaining;
+
+                if (event.get_status() == STATUS_BYTE::META) // meta length is kept in the payload, sysex length is not
+                {
+                    event.push_byte(next_byte);
+                }
+
+                varlen = (varlen << 7) | (next_byte & 0b01111111);
+                ++varlen_bytes;
+
+                if (next_byte & 0b10000000)
+                {
+                    if (varlen_bytes == 4)
+                    {
+                        return fail();
+                    }
+
+                    break;
+                }
+
+                remaining = varlen;
+                varlen = 0;
+                varlen_bytes = 0;
+                current_state = STATE::PAYLOAD;
+
+                if (remaining == 0)
+                {
+                    end_event();
+                }
+
+                break;
+            }
+            case STATE::PAYLOAD:
+            case STATE::PARAMETERS:
+            {
+                size_t count = std::min<size_t>({(size_t)remaining, (size_t)(end - p), (size_t)chunk_remaining});
+
+                if ((current_state == STATE::PAYLOAD) && (event.get_status() != STATUS_BYTE::META))
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        if ((p[i] & 0b10000000) && (p[i] != STATUS_BYTE::SYSEX_F7))
+                        {
+                            return fail();
+                        }
+                    }
+                }
+
+                event.push_bytes(p, count);
+                p += count;
+                remaining -= (uint32_t)count;
+                chunk_remaining -= (uint32_t)count;
+
+                if (remaining == 0)
+                {
+                    end_event();
+                }
+
+                break;
+            }
+            case STATE::SKIP:
+            {
+                size_t count = std::min<size_t>(chunk_remaining, (size_t)(end - p));
+
+                p += count;
+                chunk_remaining -= (uint32_t)count;
+
+                if (chunk_remaining == 0)
+                {
+                    next_chunk();
+                }
+
+                break;
+            }
+            case STATE::FAIL:
+            {
+                return STATUS::FAIL;
+            }
+        }
+
+        // an event may not run past the end of its track
+        if ((chunk_remaining == 0) && (current_state >= STATE::DT) && (current_state <= STATE::PARAMETERS))
+        {
+            return fail();
+        }
+    }
+
+    return (current_state == STATE::FAIL) ? STATUS::FAIL : STATUS::STANDBY;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Stream_Decoder::finish()
+{
+    if ((current_state == STATE::CHUNK_HEAD) && (head_used == 0) && !in_file && (file_count > 0))
+    {
+        return STATUS::SUCCESS;
+    }
+
+    return STATUS::FAIL;
 }
@@ -1,5 +1,166 @@
 #include "MIDI_Encoder.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#ifdef MIDI_STATS
+#include <chrono>
+#endif
+
+/* ****************************************************************************
+ *  Buffer helpers (bulk encoding)
+ *  ************************************************************************ */
+static inline void write_u32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)((value >> 24) & 0xFF);
+    p[1] = (uint8_t)((value >> 16) & 0xFF);
+    p[2] = (uint8_t)((value >>  8) & 0xFF);
+    p[3] = (uint8_t)((value      ) & 0xFF);
+}
+
+static inline void write_u16(uint8_t* p, uint16_t value)
+{
+    p[0] = (uint8_t)((value >> 8) & 0xFF);
+    p[1] = (uint8_t)((value     ) & 0xFF);
+}
+
+static inline bool write_varlen(uint8_t*& p, uint8_t* end, uint32_t value)
+{
+    // same bytes as Varlen_Encoder; `Varlen::encode` stores 4 bytes, so go through a copy near the end
+    if ((end - p) >= 4)
+    {
+        p += Varlen::encode(value, p);
+        return true;
+    }
+
+    uint8_t bytes[4];
+    int count = Varlen::encode(value, bytes);
+
+    if ((end - p) < count)
+    {
+        return false;
+    }
+
+    std::memcpy(p, bytes, count);
+    p += count;
+
+    return true;
+}
+
+static inline bool write_bytes(uint8_t*& p, uint8_t* end, const uint8_t* bytes, size_t count)
+{
+    if ((size_t)(end - p) < count)
+    {
+        return false;
+    }
+
+    if (count > 0)
+    {
+        std::memcpy(p, bytes, count);
+        p += count;
+    }
+
+    return true;
+}
+
+#ifdef MIDI_STATS
+static inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static inline void count_event(MIDI_Stats& stats, MTrk_Event& event, bool running)
+{
+    // `running`: the status byte of a channel event is left out
+    const uint8_t* payload = event.get_payload();
+    uint32_t payload_size = event.get_payload_size();
+    uint32_t len = 0;
+
+    ++stats.dt_varlen[Varlen::byte_count(event.get_dt())];
+
+    switch (STATUS_TABLE[event.get_status()].type)
+    {
+        case STATUS_CLASS::META:
+        {
+            ++stats.meta_events;
+            ++stats.length_varlen[(payload_size > 2) ? Varlen::decode(payload + 2, payload + payload_size, len) : 0];
+            break;
+        }
+        case STATUS_CLASS::SYSEX:
+        {
+            ++stats.sysex_events;
+            ++stats.length_varlen[Varlen::byte_count(payload_size - 1)];
+            break;
+        }
+        case STATUS_CLASS::DATA:
+        {
+            break;
+        }
+        default:
+        {
+            ++stats.channel_events;
+            stats.running_status += running;
+            break;
+        }
+    }
+}
+#endif
+
+static inline bool split_event(MTrk_Event& event, uint8_t& last_status, uint8_t* prefix, size_t& prefix_size,
+                               const uint8_t*& run, size_t& run_size)
+{
+    /*
+    Splits an encoded event into the bytes that precede its stored payload
+    (delta time, and F0/F7 plus length for sysex; at most 9 bytes) and the run
+    of payload bytes that can be copied as is. Running status is applied the
+    same way as in `MTrk_Encoder::encode_byte`.
+    */
+    uint8_t event_status = event.get_status();
+    const uint8_t* payload = event.get_payload();
+    uint32_t payload_size = event.get_payload_size();
+    uint8_t* p = prefix;
+
+    write_varlen(p, prefix + 4, event.get_dt());
+
+    switch (STATUS_TABLE[event_status].type)
+    {
+        case STATUS_CLASS::META:
+        {
+            run = payload;
+            run_size = payload_size;
+            last_status = 0;
+            break;
+        }
+        case STATUS_CLASS::SYSEX:
+        {
+            *p++ = event_status;
+            write_varlen(p, prefix + 9, payload_size - 1); // len is byte count AFTER F0/F7
+            run = payload + 1;
+            run_size = payload_size - 1;
+            last_status = 0;
+            break;
+        }
+        case STATUS_CLASS::DATA:
+        {
+            return false;
+        }
+        default:
+        {
+            size_t skip = ((last_status == event_status) && ENCODE_RUNNING_STATUS && (payload_size > 1)) ? 1 : 0;
+
+            run = payload + skip;
+            run_size = payload_size - skip;
+            last_status = event_status;
+            break;
+        }
+    }
+
+    prefix_size = (size_t)(p - prefix);
+    return true;
+}
+
 /* ****************************************************************************
  *  MIDI_Element_Encoder
  *  ************************************************************************ */
@@ -26,44 +187,14 @@ MIDI_Element_Encoder::STATUS Varlen_Encoder::encode_byte(uint8_t& product)
     {
         case STATE::READ:
         {
-            if (specific_index < 3)
-            {
-                if (tmp[specific_index] == 128) // if leading byte stored in tmp is zero then skip
-                {
-                    ++specific_index;
-                    return Varlen_Encoder::encode_byte(product); // RECURSION
-                }
+            product = bytes[specific_index];
+            ++specific_index;
 
-                if (!(tmp[specific_index] & 0b10000000))
-                {
-                    // test that last byte has bit 7 clear
-                    return STATUS::FAIL;
-                }
-                else
-                {
-                    product = tmp[specific_index]; // last has msb clear
-                    ++specific_index;
-                }
-            }
-            else if (specific_index == 3)
-            {
-                if (tmp[specific_index] & 0b10000000)
-                {
-                    // test that last byte has bit 7 clear
-                    current_state = STATE::FAIL;
-                    return STATUS::FAIL;
-                }
-                else
-                {
-                    product = tmp[specific_index];
-                    current_state = STATE::DONE;
-                    return STATUS::SUCCESS;
-                }
-            }
-            else
+            if (specific_index == (size_t)count)
             {
-                current_state = STATE::FAIL;
-                return STATUS::FAIL;
+                // last byte has bit 7 clear
+                current_state = STATE::DONE;
+                return STATUS::SUCCESS;
             }
 
             break;
@@ -86,25 +217,8 @@ MIDI_Element_Encoder::STATUS Varlen_Encoder::set_data(uint32_t data)
 {
     Varlen_Encoder::clear();
 
-    uint32_t accumulator = data;
-
-    // separate data into 4 8-bit bytes
-    tmp.insert(tmp.end(), {0, 0, 0, 0});
-
-    tmp[3] = (uint8_t)(accumulator & 0b01111111);
-    accumulator >>= 7;
-
-    tmp[2] = (uint8_t)(accumulator & 0b01111111);
-    tmp[2] |= 0b10000000; // all bytes have bit 7 set except last/least sig.
-    accumulator >>= 7;
-
-    tmp[1] = (uint8_t)(accumulator & 0b01111111);
-    tmp[1] |= 0b10000000;
-    accumulator >>= 7;
-
-    tmp[0] = (uint8_t)(accumulator & 0b01111111);
-    tmp[0] |= 0b10000000;
-    accumulator >>= 7;
+    // leading zero groups are not encoded
+    count = Varlen::encode(data, bytes);
 
     return MIDI_Element_Encoder::STATUS::SUCCESS;
 
@@ -392,6 +506,13 @@ MIDI_Element_Encoder::STATUS Sysex_Message_Encoder::encode_byte(uint8_t& product
                 }
                 case STATUS::SUCCESS:
                 {
+                    if (specific_index == src_event->get_payload_size())
+                    {
+                        // an empty sysex (F0 00) ends with its length
+                        current_state = STATE::DONE;
+                        return STATUS::SUCCESS;
+                    }
+
                     current_state = STATE::PAYLOAD;
                     break;
                 }
@@ -467,7 +588,7 @@ void MTrk_Encoder::clear()
     src_chunk = nullptr;
     current_state = STATE::HEADER;
     current_status = STATUS::STANDBY;
-    event_index = 0;
+    event_it = {};
     running_status = 0;
     meta_encoder.clear();
     midi_encoder.clear();
@@ -476,85 +597,99 @@ void MTrk_Encoder::clear()
 
 MIDI_Element_Encoder::STATUS MTrk_Encoder::encode_byte(uint8_t& product)
 {
-    switch (current_state)
+    // The next event picks its encoder, which then produces its first byte
+    // below.
+    if (current_state == STATE::EVENT_TYPE)
     {
-        case STATE::HEADER:
+        if (event_it == src_chunk->end())
         {
-            if (specific_index <= tmp.size())
-            {
-                product = tmp[specific_index];
-                
-                ++specific_index;
+            current_state = STATE::DONE;
+            return STATUS::SUCCESS;
+        }
 
-                if (specific_index == tmp.size())
-                {
-                    current_state = STATE::EVENT_TYPE;
-                }
-            }
+        MTrk_Event& event = *event_it;
+        uint8_t event_status = event.get_status(); // first byte of event PAYLOAD
 
-            break;
-        }
-        case STATE::EVENT_TYPE:
+        ++event_it;
+
+        switch (STATUS_TABLE[event_status].type)
         {
-            // event index/bounds
-            if (event_index < src_chunk->size())
+            case STATUS_CLASS::META:
             {
-                // first byte of event PAYLOAD
-                if ((*src_chunk)[event_index][0] == STATUS_BYTE::META)
+                current_state = STATE::META_EVENT;
+                meta_encoder.set_data(&event);
+                running_status = 0;
+#ifdef MIDI_STATS
+                if (stats != nullptr)
                 {
-                    current_state = STATE::META_EVENT;
-                    meta_encoder.set_data(&((*src_chunk)[event_index]));
-                    ++event_index;
-                    running_status = 0;
-                    return encode_byte(product); // RECURSION
+                    count_event(*stats, event, false);
                 }
-                else if ((*src_chunk)[event_index][0] == STATUS_BYTE::SYSEX_F0 )
+#endif
+                break;
+            }
+            case STATUS_CLASS::SYSEX:
+            {
+                current_state = STATE::SYSEX_EVENT;
+                sysex_encoder.set_data(&event);
+                running_status = 0;
+#ifdef MIDI_STATS
+                if (stats != nullptr)
                 {
-                    current_state = STATE::SYSEX_EVENT;
-                    sysex_encoder.set_data(&((*src_chunk)[event_index]));
-                    ++event_index;
-                    running_status = 0;
-                    return encode_byte(product); // RECURSION
+                    count_event(*stats, event, false);
                 }
-                else if ((*src_chunk)[event_index][0] == STATUS_BYTE::SYSEX_F7 )
+#endif
+                break;
+            }
+            case STATUS_CLASS::DATA: // no status byte to encode
+            {
+                current_state = STATE::FAIL;
+                return STATUS::FAIL;
+            }
+            default:
+            {
+                current_state = STATE::MIDI_EVENT;
+                midi_encoder.set_data(&event);
+
+                if (running_status == event_status && ENCODE_RUNNING_STATUS)
                 {
-                    current_state = STATE::SYSEX_EVENT;
-                    sysex_encoder.set_data(&((*src_chunk)[event_index]));
-                    ++event_index;
-                    running_status = 0;
-                    return encode_byte(product); // RECURSION
+                    midi_encoder.skip_status();
                 }
-                else if ((*src_chunk)[event_index][0] & 0b10000000 ) // First bit set AND not SYSEX_F0
+
+#ifdef MIDI_STATS
+                if (stats != nullptr)
                 {
+                    count_event(*stats, event, (running_status == event_status) && ENCODE_RUNNING_STATUS);
+                }
+#endif
 
-                    current_state = STATE::MIDI_EVENT;
-                    midi_encoder.set_data(&((*src_chunk)[event_index]));
-                    
-                    if (running_status == ((*src_chunk)[event_index][0]) && ENCODE_RUNNING_STATUS)
-                    {
-                        midi_encoder.skip_status();
-                    }
+                running_status = event_status;
+                break;
+            }
+        }
+    }
 
-                    running_status = (*src_chunk)[event_index][0];
-                    
-                    ++event_index;
+    switch (current_state)
+    {
+        case STATE::HEADER:
+        {
+            if (specific_index <= tmp.size())
+            {
+                product = tmp[specific_index];
+                
+                ++specific_index;
 
-                    return encode_byte(product); // RECURSION
+                if (specific_index == tmp.size())
+                {
+                    current_state = STATE::EVENT_TYPE;
                 }
             }
-            else if (event_index == src_chunk->size())
-            {
-                current_state = STATE::DONE;
-                return STATUS::SUCCESS;
-            }
-            else
-            {
-                current_state = STATE::FAIL;
-                return STATUS::FAIL;
-            }
 
             break;
         }
+        case STATE::EVENT_TYPE: // resolved above
+        {
+            break;
+        }
         case STATE::MIDI_EVENT:
         {
             current_status = midi_encoder.encode_byte(product);
@@ -567,7 +702,7 @@ MIDI_Element_Encoder::STATUS MTrk_Encoder::encode_byte(uint8_t& product)
                 }
                 case STATUS::SUCCESS:
                 {
-                    if (event_index == src_chunk->size())
+                    if (event_it == src_chunk->end())
                     {
                         current_state = STATE::DONE;
                         return STATUS::SUCCESS;
@@ -597,7 +732,7 @@ MIDI_Element_Encoder::STATUS MTrk_Encoder::encode_byte(uint8_t& product)
                 }
                 case STATUS::SUCCESS:
                 {
-                    if (event_index == src_chunk->size())
+                    if (event_it == src_chunk->end())
                     {
                         current_state = STATE::DONE;
                         return STATUS::SUCCESS;
@@ -627,7 +762,7 @@ MIDI_Element_Encoder::STATUS MTrk_Encoder::encode_byte(uint8_t& product)
                 }
                 case STATUS::SUCCESS:
                 {
-                    if (event_index == src_chunk->size())
+                    if (event_it == src_chunk->end())
                     {
                         current_state = STATE::DONE;
                         return STATUS::SUCCESS;
@@ -673,7 +808,7 @@ MIDI_Element_Encoder::STATUS MTrk_Encoder::set_data(MIDI_Element* data)
     src = data;
     src_chunk = static_cast<MTrk_Chunk*>(src);
 
-    event_index = 0;
+    event_it = src_chunk->begin();
 
     tmp.insert(tmp.end(),
     {
@@ -691,6 +826,118 @@ MIDI_Element_Encoder::STATUS MTrk_Encoder::set_data(MIDI_Element* data)
     return STATUS::SUCCESS;
 }
 
+MIDI_Element_Encoder::STATUS MTrk_Encoder::encode(MTrk_Chunk& chunk, uint8_t* out, size_t size)
+{
+    /*
+    Same bytes as `encode_byte`, written straight into `out`. `size` must be
+    exactly 8 + `chunk.get_len()`.
+    */
+    uint8_t* p = out;
+    uint8_t* end = out + size;
+    uint8_t last_status = 0;
+    uint8_t prefix[9];
+    size_t prefix_size = 0;
+    const uint8_t* run = nullptr;
+    size_t run_size = 0;
+
+    current_state = STATE::FAIL;
+
+    if (size != 8 + (size_t)chunk.get_len())
+    {
+        return STATUS::FAIL;
+    }
+
+    write_u32(p, chunk.get_header());
+    write_u32(p + 4, chunk.get_len());
+    p += 8;
+
+    for (MTrk_Event& event : chunk)
+    {
+        if (!split_event(event, last_status, prefix, prefix_size, run, run_size) ||
+            !write_bytes(p, end, prefix, prefix_size) || !write_bytes(p, end, run, run_size))
+        {
+            return STATUS::FAIL;
+        }
+
+#ifdef MIDI_STATS
+        if (stats != nullptr)
+        {
+            count_event(*stats, event, run != event.get_payload());
+        }
+#endif
+    }
+
+    if (p != end)
+    {
+        return STATUS::FAIL;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Encoder::STATUS MTrk_Encoder::encode(MTrk_Chunk& chunk, MIDI_Sink& sink)
+{
+    /*
+    The length written first is `chunk.get_len()`. If the events do not add up
+    to it, a seekable sink gets the real length patched in; on any other sink
+    the output would be corrupt and FAIL is returned.
+    */
+    uint8_t head[8];
+    uint8_t last_status = 0;
+    uint8_t prefix[9];
+    size_t prefix_size = 0;
+    const uint8_t* run = nullptr;
+    size_t run_size = 0;
+    size_t start = sink.get_position();
+
+    current_state = STATE::FAIL;
+
+    write_u32(head, chunk.get_header());
+    write_u32(head + 4, chunk.get_len());
+
+    if (!sink.write(head, 8))
+    {
+        return STATUS::FAIL;
+    }
+
+    for (MTrk_Event& event : chunk)
+    {
+        if (!split_event(event, last_status, prefix, prefix_size, run, run_size) ||
+            !sink.write(prefix, prefix_size) || !sink.write(run, run_size))
+        {
+            return STATUS::FAIL;
+        }
+
+#ifdef MIDI_STATS
+        if (stats != nullptr)
+        {
+            count_event(*stats, event, run != event.get_payload());
+        }
+#endif
+    }
+
+    size_t written = sink.get_position() - start - 8;
+
+    if (written > UINT32_MAX)
+    {
+        return STATUS::FAIL;
+    }
+
+    if (written != chunk.get_len())
+    {
+        write_u32(head + 4, (uint32_t)written);
+
+        if (!sink.patch(start + 4, head + 4, 4))
+        {
+            return STATUS::FAIL;
+        }
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
 /* ****************************************************************************
  * UNkn_Encoder
  *  ************************************************************************ */
@@ -786,6 +1033,50 @@ MIDI_Element_Encoder::STATUS UNkn_Encoder::set_data(MIDI_Element* data)
     return STATUS::SUCCESS;
 }
 
+MIDI_Element_Encoder::STATUS UNkn_Encoder::encode(UNkn_Chunk& chunk, uint8_t* out, size_t size)
+{
+    current_state = STATE::FAIL;
+
+    if ((size != 8 + (size_t)chunk.get_len()) || (chunk.get_byte_count() < chunk.get_len()))
+    {
+        return STATUS::FAIL;
+    }
+
+    write_u32(out, chunk.get_header());
+    write_u32(out + 4, chunk.get_len());
+
+    if (chunk.get_len() > 0)
+    {
+        std::memcpy(out + 8, chunk.get_bytes(), chunk.get_len());
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Encoder::STATUS UNkn_Encoder::encode(UNkn_Chunk& chunk, MIDI_Sink& sink)
+{
+    uint8_t head[8];
+
+    current_state = STATE::FAIL;
+
+    if (chunk.get_byte_count() < chunk.get_len())
+    {
+        return STATUS::FAIL;
+    }
+
+    write_u32(head, chunk.get_header());
+    write_u32(head + 4, chunk.get_len());
+
+    if (!sink.write(head, 8) || !sink.write(chunk.get_bytes(), chunk.get_len()))
+    {
+        return STATUS::FAIL;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
 
 /* ****************************************************************************
  * MThd__Encoder
@@ -899,6 +1190,59 @@ MIDI_Element_Encoder::STATUS MThd_Encoder::set_data(MIDI_Element* data)
     return STATUS::SUCCESS;
 }
 
+MIDI_Element_Encoder::STATUS MThd_Encoder::encode(MThd_Chunk& chunk, uint8_t* out, size_t size)
+{
+    size_t extended = (chunk.get_len() > 6) ? (chunk.get_len() - 6) : 0; // 6 for fmt, ntrks, div
+
+    current_state = STATE::FAIL;
+
+    if ((size != 14 + extended) || (chunk.get_extended_size() < extended))
+    {
+        return STATUS::FAIL;
+    }
+
+    write_u32(out, chunk.get_header());
+    write_u32(out + 4, chunk.get_len());
+    write_u16(out + 8, chunk.get_fmt());
+    write_u16(out + 10, chunk.get_ntrks());
+    write_u16(out + 12, chunk.get_div());
+
+    if (extended > 0)
+    {
+        std::memcpy(out + 14, chunk.get_extended_content(), extended);
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Encoder::STATUS MThd_Encoder::encode(MThd_Chunk& chunk, MIDI_Sink& sink)
+{
+    uint8_t head[14];
+    size_t extended = (chunk.get_len() > 6) ? (chunk.get_len() - 6) : 0; // 6 for fmt, ntrks, div
+
+    current_state = STATE::FAIL;
+
+    if (chunk.get_extended_size() < extended)
+    {
+        return STATUS::FAIL;
+    }
+
+    write_u32(head, chunk.get_header());
+    write_u32(head + 4, chunk.get_len());
+    write_u16(head + 8, chunk.get_fmt());
+    write_u16(head + 10, chunk.get_ntrks());
+    write_u16(head + 12, chunk.get_div());
+
+    if (!sink.write(head, 14) || !sink.write(chunk.get_extended_content(), extended))
+    {
+        return STATUS::FAIL;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
 
 /* ****************************************************************************
  *  MIDI_File_Encoder
@@ -914,10 +1258,79 @@ void MIDI_File_Encoder::clear()
     mthd_encoder.clear();
     mtrk_encoder.clear();
     unkn_encoder.clear();
+#ifdef MIDI_STATS
+    stats.clear();
+    mtrk_encoder.set_stats(&stats);
+#endif
 }
 
+#ifdef MIDI_STATS
+void MIDI_File_Encoder::begin_chunk_stats(MIDI_Chunk& chunk, uint64_t bytes)
+{
+    stats.chunks.push_back({chunk.get_header(), bytes, 0, 0});
+
+    switch (chunk.get_header())
+    {
+        case CHUNK_HEADER::MTHD:
+        {
+            stats.mthd_bytes += bytes;
+            break;
+        }
+        case CHUNK_HEADER::MTRK:
+        {
+            stats.mtrk_bytes += bytes;
+            stats.chunks.back().events = static_cast<MTrk_Chunk&>(chunk).size();
+            break;
+        }
+        default:
+        {
+            stats.unkn_bytes += bytes;
+            break;
+        }
+    }
+}
+#endif
+
 MIDI_Element_Encoder::STATUS MIDI_File_Encoder::encode_byte(uint8_t& product)
 {
+    // The next chunk picks its encoder, which then produces its first byte
+    // below.
+    if (current_state == STATE::CHUNK_TYPE)
+    {
+        if (chunk_index >= src_file->get_hdr().get_ntrks())
+        {
+            current_state = STATE::FAIL;
+            return STATUS::FAIL;
+        }
+
+        if ( (*src_file).get_chunk(chunk_index).get_header() == CHUNK_HEADER::MTRK)
+        {
+            current_state = STATE::MTRK;
+            mtrk_encoder.clear();
+            mtrk_encoder.set_data(&((*src_file).get_chunk(chunk_index)));
+        }
+        else
+        {
+            current_state = STATE::UNKN;
+            unkn_encoder.clear();
+            unkn_encoder.set_data(&((*src_file).get_chunk(chunk_index)));
+        }
+
+#ifdef MIDI_STATS
+        begin_chunk_stats(src_file->get_chunk(chunk_index), 8 + (uint64_t)src_file->get_chunk(chunk_index).get_len());
+#endif
+
+        ++chunk_index;
+    }
+
+#ifdef MIDI_STATS
+    if ((current_state == STATE::MTHD_HEADER) && stats.chunks.empty())
+    {
+        MThd_Chunk& hdr = src_file->get_hdr();
+        begin_chunk_stats(hdr, 14 + ((hdr.get_len() > 6) ? (hdr.get_len() - 6) : 0));
+    }
+#endif
+
     switch (current_state)
     {
         case STATE::MTHD_HEADER:
@@ -952,30 +1365,9 @@ MIDI_Element_Encoder::STATUS MIDI_File_Encoder::encode_byte(uint8_t& product)
 
             break;
         }
-        case STATE::CHUNK_TYPE:
+        case STATE::CHUNK_TYPE: // resolved above
         {
-            if (chunk_index >= src_file->get_hdr().get_ntrks())
-            {
-                current_state = STATE::FAIL;
-                return STATUS::FAIL;
-            }
-            
-            if ( (*src_file).get_chunk(chunk_index).get_header() == CHUNK_HEADER::MTRK)
-            {
-                current_state = STATE::MTRK;
-                mtrk_encoder.clear();
-                mtrk_encoder.set_data(&((*src_file).get_chunk(chunk_index)));
-            }
-            else
-            {
-                current_state = STATE::UNKN;
-                unkn_encoder.clear();
-                unkn_encoder.set_data(&((*src_file).get_chunk(chunk_index)));
-            }
-
-            ++chunk_index;
-
-            return encode_byte(product); // RECURSION
+            break;
         }
         case STATE::MTRK:
         {
@@ -1075,3 +1467,286 @@ MIDI_Element_Encoder::STATUS MIDI_File_Encoder::set_data(MIDI_Element* data)
     return STATUS::SUCCESS;
 
 }
+
+size_t MIDI_File_Encoder::get_encoded_size()
+{
+    if (src_file == nullptr)
+    {
+        return 0;
+    }
+
+    MThd_Chunk& hdr = src_file->get_hdr();
+    size_t total = 14 + ((hdr.get_len() > 6) ? (hdr.get_len() - 6) : 0);
+
+    for (size_t i = 0; i < hdr.get_ntrks(); ++i)
+    {
+        total += 8 + (size_t)src_file->get_chunk(i).get_len();
+    }
+
+    return total;
+}
+
+MIDI_Element_Encoder::STATUS MIDI_File_Encoder::encode_to(std::vector<uint8_t>& product)
+{
+#ifdef MIDI_STATS
+    size_t capacity = product.capacity();
+#endif
+
+    product.resize(get_encoded_size());
+
+#ifdef MIDI_STATS
+    stats.allocations += (product.capacity() > capacity);
+#endif
+
+    return encode_to(product.data(), product.size());
+}
+
+MIDI_Element_Encoder::STATUS MIDI_File_Encoder::encode_to(uint8_t* out, size_t cap)
+{
+    if ((src_file == nullptr) || (cap < get_encoded_size()))
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    MThd_Chunk& hdr = src_file->get_hdr();
+    size_t size = 14 + ((hdr.get_len() > 6) ? (hdr.get_len() - 6) : 0);
+
+#ifdef MIDI_STATS
+    auto start = std::chrono::steady_clock::now();
+    begin_chunk_stats(hdr, size);
+#endif
+
+    if (mthd_encoder.encode(hdr, out, size) == STATUS::FAIL)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+#ifdef MIDI_STATS
+    stats.chunks.back().nanoseconds = elapsed_ns(start);
+#endif
+
+    out += size;
+
+    for (chunk_index = 0; chunk_index < hdr.get_ntrks(); ++chunk_index)
+    {
+        MIDI_Chunk& chunk = src_file->get_chunk(chunk_index);
+        size = 8 + (size_t)chunk.get_len();
+
+#ifdef MIDI_STATS
+        start = std::chrono::steady_clock::now();
+        begin_chunk_stats(chunk, size);
+#endif
+
+        if (chunk.get_header() == CHUNK_HEADER::MTRK)
+        {
+            current_status = mtrk_encoder.encode(static_cast<MTrk_Chunk&>(chunk), out, size);
+        }
+        else
+        {
+            current_status = unkn_encoder.encode(static_cast<UNkn_Chunk&>(chunk), out, size);
+        }
+
+        if (current_status == STATUS::FAIL)
+        {
+            current_state = STATE::FAIL;
+            return STATUS::FAIL;
+        }
+
+#ifdef MIDI_STATS
+        stats.chunks.back().nanoseconds = elapsed_ns(start);
+#endif
+
+        out += size;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Encoder::STATUS MIDI_File_Encoder::encode_to(MIDI_Sink& sink)
+{
+#ifdef MIDI_STATS
+    auto start = std::chrono::steady_clock::now();
+    size_t position = sink.get_position();
+#endif
+
+    if ((src_file == nullptr) || (mthd_encoder.encode(src_file->get_hdr(), sink) == STATUS::FAIL))
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+#ifdef MIDI_STATS
+    begin_chunk_stats(src_file->get_hdr(), sink.get_position() - position);
+    stats.chunks.back().nanoseconds = elapsed_ns(start);
+#endif
+
+    for (chunk_index = 0; chunk_index < src_file->get_hdr().get_ntrks(); ++chunk_index)
+    {
+        MIDI_Chunk& chunk = src_file->get_chunk(chunk_index);
+
+#ifdef MIDI_STATS
+        start = std::chrono::steady_clock::now();
+        position = sink.get_position();
+#endif
+
+        if (chunk.get_header() == CHUNK_HEADER::MTRK)
+        {
+            current_status = mtrk_encoder.encode(static_cast<MTrk_Chunk&>(chunk), sink);
+        }
+        else
+        {
+            current_status = unkn_encoder.encode(static_cast<UNkn_Chunk&>(chunk), sink);
+        }
+
+        if (current_status == STATUS::FAIL)
+        {
+            current_state = STATE::FAIL;
+            return STATUS::FAIL;
+        }
+
+#ifdef MIDI_STATS
+        begin_chunk_stats(chunk, sink.get_position() - position); // events were counted as they were written
+        stats.chunks.back().nanoseconds = elapsed_ns(start);
+#endif
+    }
+
+    if (!sink.flush())
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
+
+MIDI_Element_Encoder::STATUS MIDI_File_Encoder::encode_parallel(std::vector<uint8_t>& product, unsigned thread_count)
+{
+    struct Chunk_Job
+    {
+        MIDI_Chunk*     chunk;
+        size_t          offset;
+        size_t          size;
+#ifdef MIDI_STATS
+        MIDI_Stats      stats;
+        uint64_t        nanoseconds;
+#endif
+    };
+
+    if (src_file == nullptr)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    MThd_Chunk& hdr = src_file->get_hdr();
+    size_t mthd_size = 14 + ((hdr.get_len() > 6) ? (hdr.get_len() - 6) : 0);
+    size_t total = mthd_size;
+    std::vector<Chunk_Job> jobs{};
+
+    for (size_t i = 0; i < hdr.get_ntrks(); ++i)
+    {
+        MIDI_Chunk& chunk = src_file->get_chunk(i);
+        size_t size = 8 + (size_t)chunk.get_len();
+
+        jobs.push_back({&chunk, total, size});
+        total += size;
+    }
+
+#ifdef MIDI_STATS
+    size_t capacity = product.capacity();
+#endif
+
+    product.resize(total);
+
+#ifdef MIDI_STATS
+    stats.allocations += (product.capacity() > capacity);
+    begin_chunk_stats(hdr, mthd_size);
+#endif
+
+    if (mthd_encoder.encode(hdr, product.data(), mthd_size) == STATUS::FAIL)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    std::atomic<size_t> next_job{0};
+    std::atomic<bool> failed{false};
+
+    auto worker = [&jobs, &next_job, &failed, &product]()
+    {
+        MTrk_Encoder mtrk{};
+        UNkn_Encoder unkn{};
+        STATUS status{};
+
+        for (size_t i = next_job++; (i < jobs.size()) && !failed; i = next_job++)
+        {
+            uint8_t* out = product.data() + jobs[i].offset;
+
+#ifdef MIDI_STATS
+            auto start = std::chrono::steady_clock::now();
+            mtrk.set_stats(&jobs[i].stats);
+#endif
+
+            if (jobs[i].chunk->get_header() == CHUNK_HEADER::MTRK)
+            {
+                status = mtrk.encode(*static_cast<MTrk_Chunk*>(jobs[i].chunk), out, jobs[i].size);
+            }
+            else
+            {
+                status = unkn.encode(*static_cast<UNkn_Chunk*>(jobs[i].chunk), out, jobs[i].size);
+            }
+
+            if (status == STATUS::FAIL)
+            {
+                failed = true;
+            }
+
+#ifdef MIDI_STATS
+            jobs[i].nanoseconds = elapsed_ns(start);
+#endif
+        }
+    };
+    if (thread_count == 0)
+    {
+        thread_count = std::thread::hardware_concurrency();
+    }
+
+    size_t worker_count = std::min<size_t>(thread_count, jobs.size());
+    std::vector<std::thread> threads{};
+
+    for (size_t i = 1; i < worker_count; ++i) // the calling thread is the last worker
+    {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    chunk_index = jobs.size();
+
+#ifdef MIDI_STATS
+    for (Chunk_Job& job : jobs)
+    {
+        begin_chunk_stats(*job.chunk, job.size);
+        stats.add_events(job.stats);
+        stats.chunks.back().nanoseconds = job.nanoseconds;
+    }
+#endif
+
+    if (failed)
+    {
+        current_state = STATE::FAIL;
+        return STATUS::FAIL;
+    }
+
+    current_state = STATE::DONE;
+    return STATUS::SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include "MIDI_Loader.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ****************************************************************************
+*  MIDI_File_Loader
+*  ************************************************************************* */
+MIDI_File_Loader::~MIDI_File_Loader()
+{
+    close();
+}
+
+bool MIDI_File_Loader::open(const char* path)
+{
+    close();
+
+    if (path == nullptr)
+    {
+        return false;
+    }
+
+    if (std::strcmp(path, "-") == 0)
+    {
+        return read_all(STDIN_FILENO);
+    }
+
+    int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info{};
+    bool success = false;
+
+    if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0))
+    {
+        void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+            madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+            madvise(mapping, (size_t)info.st_size, MADV_WILLNEED);
+
+            data = static_cast<const uint8_t*>(mapping);
+            size = (size_t)info.st_size;
+            mapped = true;
+            success = true;
+        }
+    }
+
+    if (!mapped)
+    {
+        // pipes, devices, empty files or a failed mmap
+        success = read_all(fd);
+    }
+
+    ::close(fd); // a mapping stays valid after its descriptor is closed
+
+    return success;
+}
+
+bool MIDI_File_Loader::read_all(int fd)
+{
+    const size_t block = 1 << 16;
+    size_t used = 0;
+
+    buffer.clear();
+
+    while (true)
+    {
+        buffer.resize(used + block);
+
+        ssize_t count = ::read(fd, buffer.data() + used, block);
+
+        if (count > 0)
+        {
+            used += (size_t)count;
+        }
+        else if (count == 0)
+        {
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            buffer.clear();
+            return false;
+        }
+    }
+
+    buffer.resize(used);
+
+    data = buffer.data();
+    size = buffer.size();
+    mapped = false;
+
+    return true;
+}
+
+void MIDI_File_Loader::close()
+{
+    if (mapped)
+    {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    buffer.clear();
+}
+
+MIDI_Element_Decoder::STATUS MIDI_File_Loader::load(const char* path, MIDI_File& product)
+{
+    if (!open(path))
+    {
+        return MIDI_Element_Decoder::STATUS::FAIL;
+    }
+
+    decoder.clear();
+
+    return decoder.decode(data, size, product);
+}
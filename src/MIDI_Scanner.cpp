@@ -0,0 +1,560 @@
+#include "MIDI_Scanner.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MIDI_SCAN_SSE2
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MIDI_SCAN_AVX2
+#endif
+
+/* ****************************************************************************
+*  Buffer helpers
+*  ************************************************************************* */
+static inline uint32_t read_u32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint16_t read_u16(const uint8_t* p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]);
+}
+
+static inline unsigned lowest_set(uint64_t bits)
+{
+    if (bits == 0)
+    {
+        return 64;
+    }
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(bits);
+#else
+    unsigned count = 0;
+
+    while (!(bits & 1))
+    {
+        bits >>= 1;
+        ++count;
+    }
+
+    return count;
+#endif
+}
+
+/* ****************************************************************************
+*  Kernels
+*  ************************************************************************* */
+/*
+Each kernel provides the same three loops:
+  high_bits    bit i of the result is bit 7 of p[i], for exactly 64 bytes
+  sysex_clean  true when no byte of p[0, len) has bit 7 set, except F7
+  find_tag     offset of the first 4-byte big-endian `tag` in p[0, len), or len
+*/
+struct Scan_Kernel
+{
+    uint64_t    (*high_bits)(const uint8_t* p);
+    bool        (*sysex_clean)(const uint8_t* p, size_t len);
+    size_t      (*find_tag)(const uint8_t* p, size_t len, uint32_t tag);
+};
+
+static uint64_t high_bits_scalar(const uint8_t* p)
+{
+    uint64_t bits = 0;
+
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        bits |= (uint64_t)(p[i] >> 7) << i;
+    }
+
+    return bits;
+}
+
+static bool sysex_clean_scalar(const uint8_t* p, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if ((p[i] & 0b10000000) && (p[i] != STATUS_BYTE::SYSEX_F7))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static size_t find_tag_scalar(const uint8_t* p, size_t len, uint32_t tag)
+{
+    for (size_t i = 0; (i + 4) <= len; ++i)
+    {
+        if (read_u32(p + i) == tag)
+        {
+            return i;
+        }
+    }
+
+    return len;
+}
+
+#if defined(MIDI_SCAN_SSE2)
+static uint64_t high_bits_sse2(const uint8_t* p)
+{
+    uint64_t b0 = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p)));
+    uint64_t b1 = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p + 16)));
+    uint64_t b2 = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p + 32)));
+    uint64_t b3 = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p + 48)));
+
+    return b0 | (b1 << 16) | (b2 << 32) | (b3 << 48);
+}
+
+static bool sysex_clean_sse2(const uint8_t* p, size_t len)
+{
+    const __m128i f7 = _mm_set1_epi8((char)STATUS_BYTE::SYSEX_F7);
+    size_t i = 0;
+
+    for (; (i + 16) <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+
+        if (_mm_movemask_epi8(v) & ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, f7)))
+        {
+            return false;
+        }
+    }
+
+    return sysex_clean_scalar(p + i, len - i);
+}
+
+static size_t find_tag_sse2(const uint8_t* p, size_t len, uint32_t tag)
+{
+    // candidates are positions where all four tag bytes line up
+    const __m128i t0 = _mm_set1_epi8((char)(tag >> 24));
+    const __m128i t1 = _mm_set1_epi8((char)(tag >> 16));
+    const __m128i t2 = _mm_set1_epi8((char)(tag >> 8));
+    const __m128i t3 = _mm_set1_epi8((char)tag);
+    size_t i = 0;
+
+    for (; (i + 19) <= len; i += 16)
+    {
+        __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), t0),
+                                                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 1)), t1)),
+                                  _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 2)), t2),
+                                                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 3)), t3)));
+        unsigned bits = (unsigned)_mm_movemask_epi8(m);
+
+        if (bits)
+        {
+            return i + lowest_set(bits);
+        }
+    }
+
+    return i + find_tag_scalar(p + i, len - i, tag);
+}
+#endif
+
+#if defined(MIDI_SCAN_AVX2)
+__attribute__((target("avx2")))
+static uint64_t high_bits_avx2(const uint8_t* p)
+{
+    uint64_t b0 = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(p)));
+    uint64_t b1 = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(p + 32)));
+
+    return b0 | (b1 << 32);
+}
+
+__attribute__((target("avx2")))
+static bool sysex_clean_avx2(const uint8_t* p, size_t len)
+{
+    const __m256i f7 = _mm256_set1_epi8((char)STATUS_BYTE::SYSEX_F7);
+    size_t i = 0;
+
+    for (; (i + 32) <= len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+
+        if ((uint32_t)_mm256_movemask_epi8(v) & ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, f7)))
+        {
+            return false;
+        }
+    }
+
+    return sysex_clean_scalar(p + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_tag_avx2(const uint8_t* p, size_t len, uint32_t tag)
+{
+    const __m256i t0 = _mm256_set1_epi8((char)(tag >> 24));
+    const __m256i t1 = _mm256_set1_epi8((char)(tag >> 16));
+    const __m256i t2 = _mm256_set1_epi8((char)(tag >> 8));
+    const __m256i t3 = _mm256_set1_epi8((char)tag);
+    size_t i = 0;
+
+    for (; (i + 35) <= len; i += 32)
+    {
+        __m256i m = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i)), t0),
+                                                      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i + 1)), t1)),
+                                     _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i + 2)), t2),
+                                                      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i + 3)), t3)));
+        uint32_t bits = (uint32_t)_mm256_movemask_epi8(m);
+
+        if (bits)
+        {
+            return i + lowest_set(bits);
+        }
+    }
+
+    return i + find_tag_scalar(p + i, len - i, tag);
+}
+#endif
+
+static const Scan_Kernel& get_scan_kernel(MIDI_Scanner::KERNEL kernel)
+{
+    static const Scan_Kernel scalar{high_bits_scalar, sysex_clean_scalar, find_tag_scalar};
+#if defined(MIDI_SCAN_SSE2)
+    static const Scan_Kernel sse2{high_bits_sse2, sysex_clean_sse2, find_tag_sse2};
+#endif
+#if defined(MIDI_SCAN_AVX2)
+    static const Scan_Kernel avx2{high_bits_avx2, sysex_clean_avx2, find_tag_avx2};
+#endif
+
+    switch (kernel)
+    {
+#if defined(MIDI_SCAN_AVX2)
+        case MIDI_Scanner::KERNEL::AVX2:
+        {
+            return avx2;
+        }
+#endif
+#if defined(MIDI_SCAN_SSE2)
+        case MIDI_Scanner::KERNEL::SSE2:
+        {
+            return sse2;
+        }
+#endif
+        default:
+        {
+            return scalar;
+        }
+    }
+}
+
+/* ****************************************************************************
+*  High_Bit_Window
+*  ************************************************************************* */
+class High_Bit_Window
+{
+/*
+Bit 7 of 64 consecutive bytes starting at `base`. Bytes past the end of the
+track read as set, so a delta time or length cut off by the end of the track
+never looks terminated. `at(p)` keeps at least 8 bits valid after `p`, more than
+the 5 a varlen and the byte after it need.
+*/
+protected:
+                    const Scan_Kernel&      kernel;
+                    const uint8_t*          base;
+                    const uint8_t*          end;
+                    uint64_t                bits{0};
+
+                    void                    load(const uint8_t* p);
+public:
+                                            High_Bit_Window(const Scan_Kernel& new_kernel, const uint8_t* body, const uint8_t* new_end);
+
+                    uint64_t                at(const uint8_t* p);
+};
+
+High_Bit_Window::High_Bit_Window(const Scan_Kernel& new_kernel, const uint8_t* body, const uint8_t* new_end):
+    kernel{new_kernel}, base{body}, end{new_end}
+{
+    load(body);
+}
+
+void High_Bit_Window::load(const uint8_t* p)
+{
+    base = p;
+
+    if ((size_t)(end - p) >= 64)
+    {
+        bits = kernel.high_bits(p);
+        return;
+    }
+
+    bits = ~(uint64_t)0;
+
+    for (size_t i = 0; i < (size_t)(end - p); ++i)
+    {
+        if (!(p[i] & 0b10000000))
+        {
+            bits &= ~((uint64_t)1 << i);
+        }
+    }
+}
+
+inline uint64_t High_Bit_Window::at(const uint8_t* p)
+{
+    if ((size_t)(p - base) > 56)
+    {
+        load(p);
+    }
+
+    return bits >> (p - base);
+}
+
+static inline bool read_varlen(const uint8_t*& p, uint64_t bits, uint32_t& value)
+{
+    // same limits as Varlen_Decoder: at most 4 bytes, last byte has bit 7 clear
+    unsigned count = lowest_set(~bits) + 1;
+
+    if (count > 4)
+    {
+        return false;
+    }
+
+    value = 0;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        value = (value << 7) | (p[i] & 0b01111111);
+    }
+
+    p += count;
+    return true;
+}
+
+/* ****************************************************************************
+*  MIDI_Scanner
+*  ************************************************************************* */
+MIDI_Scanner::KERNEL MIDI_Scanner::best_kernel()
+{
+    if (supports(KERNEL::AVX2))
+    {
+        return KERNEL::AVX2;
+    }
+    else if (supports(KERNEL::SSE2))
+    {
+        return KERNEL::SSE2;
+    }
+
+    return KERNEL::SCALAR;
+}
+
+bool MIDI_Scanner::supports(KERNEL new_kernel)
+{
+    switch (new_kernel)
+    {
+        case KERNEL::SCALAR:
+        {
+            return true;
+        }
+        case KERNEL::SSE2:
+        {
+#if defined(MIDI_SCAN_SSE2)
+            return true;
+#else
+            return false;
+#endif
+        }
+        case KERNEL::AVX2:
+        {
+#if defined(MIDI_SCAN_AVX2)
+            __builtin_cpu_init(); // may run before main, from a static initializer
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        }
+    }
+
+    return false;
+}
+
+bool MIDI_Scanner::set_kernel(KERNEL new_kernel)
+{
+    if (!supports(new_kernel))
+    {
+        return false;
+    }
+
+    kernel = new_kernel;
+    return true;
+}
+
+void MIDI_Scanner::clear()
+{
+    chunks.clear();
+    size = 0;
+    event_count = 0;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Scanner::scan(const uint8_t* data, size_t len)
+{
+    size_t pos = 0;
+    uint32_t announced_tracks = 0;
+
+    clear();
+
+    while (chunks.empty() || ((chunks.size() - 1) < announced_tracks))
+    {
+        if ((len - pos) < 8)
+        {
+            return MIDI_Element_Decoder::STATUS::FAIL;
+        }
+
+        uint32_t header = read_u32(data + pos);
+        uint32_t chunk_len = read_u32(data + pos + 4);
+
+        if ((uint64_t)chunk_len > (uint64_t)(len - pos - 8))
+        {
+            return MIDI_Element_Decoder::STATUS::FAIL;
+        }
+
+        if (chunks.empty())
+        {
+            if ((header != CHUNK_HEADER::MTHD) || (chunk_len < 6))
+            {
+                return MIDI_Element_Decoder::STATUS::FAIL;
+            }
+
+            announced_tracks = read_u16(data + pos + 10);
+        }
+
+        MIDI_Chunk_Span chunk{};
+        chunk.header = header;
+        chunk.body = data + pos + 8;
+        chunk.len = chunk_len;
+        chunks.push_back(chunk);
+
+        pos += 8 + (size_t)chunk_len;
+    }
+
+    size = pos;
+    return MIDI_Element_Decoder::STATUS::SUCCESS;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Scanner::validate(const uint8_t* data, size_t len)
+{
+    if (scan(data, len) == MIDI_Element_Decoder::STATUS::FAIL)
+    {
+        return MIDI_Element_Decoder::STATUS::FAIL;
+    }
+
+    for (size_t i = 1; i < chunks.size(); ++i)
+    {
+        MIDI_Chunk_Span& chunk = chunks[i];
+
+        if (chunk.header != CHUNK_HEADER::MTRK)
+        {
+            continue;
+        }
+
+        if (check_track(chunk.body, chunk.len, chunk.event_count, chunk.byte_count) == MIDI_Element_Decoder::STATUS::FAIL)
+        {
+            return MIDI_Element_Decoder::STATUS::FAIL;
+        }
+
+        event_count += chunk.event_count;
+    }
+
+    return MIDI_Element_Decoder::STATUS::SUCCESS;
+}
+
+MIDI_Element_Decoder::STATUS MIDI_Scanner::check_track(const uint8_t* body, uint32_t len, size_t& events, size_t& bytes)
+{
+    // same rules as MTrk_Chunk_Decoder::decode
+    const Scan_Kernel& k = get_scan_kernel(kernel);
+    const uint8_t* p = body;
+    const uint8_t* end = body + len;
+    uint8_t running_status = 0;
+    uint32_t dt = 0;
+    uint32_t payload_len = 0;
+
+    events = 0;
+    bytes = 0;
+
+    if (len == 0) // an empty MTrk chunk does not decode either
+    {
+        return MIDI_Element_Decoder::STATUS::FAIL;
+    }
+
+    High_Bit_Window window(k, body, end);
+
+    while (p < end)
+    {
+        if (!read_varlen(p, window.at(p), dt) || (p == end))
+        {
+            return MIDI_Element_Decoder::STATUS::FAIL;
+        }
+
+        const uint8_t* start = p;
+        STATUS_CLASS type = STATUS_TABLE[*p].type;
+
+        if (type == STATUS_CLASS::META)
+        {
+            p += 1;
+
+            if (p == end)
+            {
+                return MIDI_Element_Decoder::STATUS::FAIL;
+            }
+
+            p += 1;
+
+            if (!read_varlen(p, window.at(p), payload_len) || ((uint32_t)(end - p) < payload_len))
+            {
+                return MIDI_Element_Decoder::STATUS::FAIL;
+            }
+
+            p += payload_len;
+
+            if ((size_t)(p - start) > MTrk_Event::INLINE_CAPACITY) // shorter payloads stay in the event
+            {
+                bytes += (size_t)(p - start);
+            }
+        }
+        else if (type == STATUS_CLASS::SYSEX)
+        {
+            p += 1;
+
+            if (!read_varlen(p, window.at(p), payload_len) || ((uint32_t)(end - p) < payload_len) ||
+                !k.sysex_clean(p, payload_len))
+            {
+                return MIDI_Element_Decoder::STATUS::FAIL;
+            }
+
+            p += payload_len;
+
+            if (((size_t)payload_len + 1) > MTrk_Event::INLINE_CAPACITY)
+            {
+                bytes += (size_t)payload_len + 1;
+            }
+        }
+        else
+        {
+            if (type != STATUS_CLASS::DATA) // setting new running_status
+            {
+                running_status = *p;
+                p += 1;
+            }
+
+            const Status_Info& info = STATUS_TABLE[running_status];
+
+            if ((info.type != STATUS_CLASS::CHANNEL) || ((size_t)(end - p) < info.parameter_count))
+            {
+                return MIDI_Element_Decoder::STATUS::FAIL;
+            }
+
+            p += info.parameter_count; // always kept in the event
+        }
+
+        ++events;
+    }
+
+    return MIDI_Element_Decoder::STATUS::SUCCESS;
+}
+
+size_t MIDI_Scanner::find_header(const uint8_t* data, size_t len, uint32_t header)
+{
+    return get_scan_kernel(kernel).find_tag(data, len, header);
+}
@@ -0,0 +1,229 @@
+#include "MIDI_Sink.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ****************************************************************************
+*  MIDI_Sink
+*  ************************************************************************* */
+MIDI_Sink::MIDI_Sink(size_t capacity):
+    buffer((capacity > 0) ? capacity : 1)
+{
+}
+
+bool MIDI_Sink::write(const uint8_t* bytes, size_t count)
+{
+    if (failed)
+    {
+        return false;
+    }
+
+    if (count == 0)
+    {
+        return true;
+    }
+
+    if (count <= (buffer.size() - used))
+    {
+        std::memcpy(buffer.data() + used, bytes, count);
+        used += count;
+        return true;
+    }
+
+    if (!flush())
+    {
+        return false;
+    }
+
+    if (count >= buffer.size()) // too large to be worth buffering
+    {
+        failed = !write_block(bytes, count);
+        flushed += count;
+        return !failed;
+    }
+
+    std::memcpy(buffer.data(), bytes, count);
+    used = count;
+    return true;
+}
+
+bool MIDI_Sink::flush()
+{
+    if (failed)
+    {
+        return false;
+    }
+
+    if (used > 0)
+    {
+        failed = !write_block(buffer.data(), used);
+        flushed += used;
+        used = 0;
+    }
+
+    return !failed;
+}
+
+bool MIDI_Sink::patch(size_t position, const uint8_t* bytes, size_t count)
+{
+    if (failed || ((position + count) > get_position()))
+    {
+        return false;
+    }
+
+    // part already flushed
+    if (position < flushed)
+    {
+        size_t head = ((position + count) <= flushed) ? count : (flushed - position);
+
+        if (!write_at(position, bytes, head))
+        {
+            return false;
+        }
+
+        position += head;
+        bytes += head;
+        count -= head;
+    }
+
+    // part still buffered
+    if (count > 0)
+    {
+        std::memcpy(buffer.data() + (position - flushed), bytes, count);
+    }
+
+    return true;
+}
+
+/* ****************************************************************************
+*  MIDI_Fd_Sink
+*  ************************************************************************* */
+MIDI_Fd_Sink::MIDI_Fd_Sink(int new_fd, size_t capacity):
+    MIDI_Sink(capacity), fd{new_fd}
+{
+    struct stat info{};
+
+    if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode))
+    {
+        start = (long long)lseek(fd, 0, SEEK_CUR);
+    }
+}
+
+MIDI_Fd_Sink::~MIDI_Fd_Sink()
+{
+    flush();
+}
+
+bool MIDI_Fd_Sink::seekable()
+{
+    return start >= 0;
+}
+
+bool MIDI_Fd_Sink::write_block(const uint8_t* bytes, size_t count)
+{
+    while (count > 0)
+    {
+        ssize_t written = ::write(fd, bytes, count);
+
+        if (written > 0)
+        {
+            bytes += written;
+            count -= (size_t)written;
+        }
+        else if ((written == 0) || (errno != EINTR)) // no progress would spin forever
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MIDI_Fd_Sink::write_at(size_t position, const uint8_t* bytes, size_t count)
+{
+    if (!seekable())
+    {
+        return false;
+    }
+
+    while (count > 0)
+    {
+        ssize_t written = pwrite(fd, bytes, count, (off_t)(start + (long long)position));
+
+        if (written > 0)
+        {
+            bytes += written;
+            count -= (size_t)written;
+            position += (size_t)written;
+        }
+        else if ((written == 0) || (errno != EINTR)) // no progress would spin forever
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* ****************************************************************************
+*  MIDI_Ostream_Sink
+*  ************************************************************************* */
+MIDI_Ostream_Sink::MIDI_Ostream_Sink(std::ostream& new_stream, size_t capacity):
+    MIDI_Sink(capacity), stream{new_stream}
+{
+    start = stream.tellp();
+}
+
+MIDI_Ostream_Sink::~MIDI_Ostream_Sink()
+{
+    flush();
+}
+
+bool MIDI_Ostream_Sink::seekable()
+{
+    return start != std::streampos(-1);
+}
+
+bool MIDI_Ostream_Sink::write_block(const uint8_t* bytes, size_t count)
+{
+    stream.write(reinterpret_cast<const char*>(bytes), (std::streamsize)count);
+
+    return stream.good();
+}
+
+bool MIDI_Ostream_Sink::write_at(size_t position, const uint8_t* bytes, size_t count)
+{
+    if (!seekable())
+    {
+        return false;
+    }
+
+    std::streampos current = stream.tellp();
+
+    stream.seekp(start + (std::streamoff)position);
+    stream.write(reinterpret_cast<const char*>(bytes), (std::streamsize)count);
+    stream.seekp(current);
+
+    return stream.good();
+}
+
+/* ****************************************************************************
+*  MIDI_Callback_Sink
+*  ************************************************************************* */
+MIDI_Callback_Sink::MIDI_Callback_Sink(std::function<bool(const uint8_t*, size_t)> new_callback, size_t capacity):
+    MIDI_Sink(capacity), callback{new_callback}
+{
+}
+
+MIDI_Callback_Sink::~MIDI_Callback_Sink()
+{
+    flush();
+}
+
+bool MIDI_Callback_Sink::write_block(const uint8_t* bytes, size_t count)
+{
+    return callback ? callback(bytes, count) : false;
+}
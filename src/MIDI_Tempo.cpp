@@ -0,0 +1,263 @@
+#include <algorithm>
+
+#include "MIDI_Tempo.h"
+
+/* ****************************************************************************
+*  MIDI_Tempo_Map
+*  ************************************************************************* */
+void MIDI_Tempo_Map::clear()
+{
+    segments.clear();
+    changes.clear();
+    divisor = 0;
+    smpte = false;
+}
+
+bool MIDI_Tempo_Map::set_div(uint16_t div)
+{
+    if (div & 0x8000)
+    {
+        // high byte: negative frames per second, low byte: ticks per frame
+        uint32_t frames = (uint32_t)(-(int8_t)(div >> 8));
+        uint32_t ticks_per_frame = div & 0xFF;
+
+        if (ticks_per_frame == 0)
+        {
+            return false;
+        }
+
+        smpte = true;
+
+        if (frames == 29)
+        {
+            divisor = 30 * ticks_per_frame;
+            segments.push_back({0, 0, 1001000});
+        }
+        else
+        {
+            divisor = frames * ticks_per_frame;
+            segments.push_back({0, 0, 1000000});
+        }
+    }
+    else
+    {
+        if (div == 0)
+        {
+            return false;
+        }
+
+        divisor = div;
+    }
+
+    return true;
+}
+
+void MIDI_Tempo_Map::add_changes(MTrk_Chunk& track)
+{
+    uint64_t tick = 0;
+
+    for (MTrk_Event& event : track)
+    {
+        tick += event.get_dt();
+
+        // FF 51, varlen length 3, three bytes of tempo
+        if ((event.get_status() != STATUS_BYTE::META) || (event.get_payload_size() < 6) || (event[1] != 0x51))
+        {
+            continue;
+        }
+
+        const uint8_t* payload = event.get_payload();
+        const uint8_t* end = payload + event.get_payload_size();
+        uint32_t len = 0;
+        int count = Varlen::decode(payload + 2, end, len);
+
+        if ((count == 0) || (len != 3) || (payload + 2 + count + 3 != end))
+        {
+            continue;
+        }
+
+        const uint8_t* bytes = payload + 2 + count;
+        uint32_t tempo = ((uint32_t)bytes[0] << 16) | ((uint32_t)bytes[1] << 8) | (uint32_t)bytes[2];
+
+        if (tempo != 0)
+        {
+            changes.push_back({tick, 0, tempo});
+        }
+    }
+}
+
+void MIDI_Tempo_Map::make_segments()
+{
+    auto earlier = [](const MIDI_Tempo_Segment& a, const MIDI_Tempo_Segment& b){ return a.tick < b.tick; };
+
+    // tracks are merged by tick; of changes at the same tick the last in track order wins
+    if (!std::is_sorted(changes.begin(), changes.end(), earlier))
+    {
+        std::stable_sort(changes.begin(), changes.end(), earlier);
+    }
+
+    segments.push_back({0, 0, DEFAULT_TEMPO});
+
+    for (const MIDI_Tempo_Segment& change : changes)
+    {
+        MIDI_Tempo_Segment& last = segments.back();
+
+        if (change.tick == last.tick)
+        {
+            last.tempo = change.tempo;
+        }
+        else if (change.tempo != last.tempo)
+        {
+            segments.push_back({change.tick, last.scaled_us + (change.tick - last.tick) * last.tempo, change.tempo});
+        }
+    }
+
+    // a change back to the tempo before it at the same tick leaves two equal segments
+    auto same = [](const MIDI_Tempo_Segment& a, const MIDI_Tempo_Segment& b){ return a.tempo == b.tempo; };
+    segments.erase(std::unique(segments.begin(), segments.end(), same), segments.end());
+}
+
+bool MIDI_Tempo_Map::build(MIDI_File& file)
+{
+    MThd_Chunk& hdr = file.get_hdr();
+
+    clear();
+
+    if (!set_div(hdr.get_div()))
+    {
+        return false;
+    }
+
+    if (smpte)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < hdr.get_ntrks(); ++i)
+    {
+        if (file.get_chunk(i).get_header() == CHUNK_HEADER::MTRK)
+        {
+            add_changes(static_cast<MTrk_Chunk&>(file.get_chunk(i)));
+        }
+    }
+
+    make_segments();
+    return true;
+}
+
+bool MIDI_Tempo_Map::build(MThd_Chunk& hdr, MTrk_Chunk& track)
+{
+    clear();
+
+    if (!set_div(hdr.get_div()))
+    {
+        return false;
+    }
+
+    if (!smpte)
+    {
+        add_changes(track);
+        make_segments();
+    }
+
+    return true;
+}
+
+size_t MIDI_Tempo_Map::find_tick(uint64_t tick)
+{
+    // the first segment starts at tick 0, so there is always one at or before `tick`
+    auto after = std::upper_bound(segments.begin(), segments.end(), tick,
+                                  [](uint64_t value, const MIDI_Tempo_Segment& segment){ return value < segment.tick; });
+
+    return (size_t)(after - segments.begin()) - 1;
+}
+
+size_t MIDI_Tempo_Map::next_tick(size_t index, uint64_t tick)
+{
+    if (tick < segments[index].tick)
+    {
+        return find_tick(tick);
+    }
+
+    while ((index + 1 < segments.size()) && (segments[index + 1].tick <= tick))
+    {
+        ++index;
+    }
+
+    return index;
+}
+
+size_t MIDI_Tempo_Map::find_scaled_us(uint64_t scaled_us)
+{
+    auto after = std::upper_bound(segments.begin(), segments.end(), scaled_us,
+                                  [](uint64_t value, const MIDI_Tempo_Segment& segment){ return value < segment.scaled_us; });
+
+    return (size_t)(after - segments.begin()) - 1;
+}
+
+uint64_t MIDI_Tempo_Map::to_microseconds(uint64_t tick)
+{
+    if (segments.empty())
+    {
+        return 0;
+    }
+
+    return convert(segments[find_tick(tick)], tick);
+}
+
+uint64_t MIDI_Tempo_Map::to_ticks(uint64_t microseconds)
+{
+    if (segments.empty())
+    {
+        return 0;
+    }
+
+    uint64_t scaled_us = microseconds * divisor;
+    MIDI_Tempo_Segment& segment = segments[find_scaled_us(scaled_us)];
+
+    return segment.tick + (scaled_us - segment.scaled_us) / segment.tempo;
+}
+
+uint32_t MIDI_Tempo_Map::get_tempo(uint64_t tick)
+{
+    if (segments.empty())
+    {
+        return 0;
+    }
+
+    return segments[find_tick(tick)].tempo;
+}
+
+void MIDI_Tempo_Map::to_microseconds(const uint64_t* ticks, size_t count, uint64_t* out)
+{
+    size_t index = 0;
+
+    if (segments.empty())
+    {
+        std::fill(out, out + count, 0);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        index = next_tick(index, ticks[i]);
+        out[i] = convert(segments[index], ticks[i]);
+    }
+}
+
+void MIDI_Tempo_Map::to_microseconds(const Channel_Event* events, size_t count, uint64_t* out)
+{
+    size_t index = 0;
+
+    if (segments.empty())
+    {
+        std::fill(out, out + count, 0);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        index = next_tick(index, events[i].tick);
+        out[i] = convert(segments[index], events[i].tick);
+    }
+}
@@ -0,0 +1,236 @@
+#include "MIDI_View.h"
+#include "MIDI_Scanner.h"
+
+/* ****************************************************************************
+*  Buffer helpers
+*  ************************************************************************* */
+static inline uint16_t read_u16(const uint8_t* p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]);
+}
+
+static inline bool read_varlen(const uint8_t*& p, const uint8_t* end, uint32_t& value)
+{
+    // same limits as Varlen_Decoder: at most 4 bytes, last byte has bit 7 clear
+    int count = Varlen::decode(p, end, value);
+
+    p += count;
+
+    return (count > 0);
+}
+
+/* ****************************************************************************
+*  MThd_View
+*  ************************************************************************* */
+uint16_t MThd_View::get_fmt()
+{
+    return read_u16(body);
+}
+
+uint16_t MThd_View::get_ntrks()
+{
+    return read_u16(body + 2);
+}
+
+uint16_t MThd_View::get_div()
+{
+    return read_u16(body + 4);
+}
+
+uint8_t MThd_View::operator[](size_t index)
+{
+    return body[6 + index];
+}
+
+/* ****************************************************************************
+*  MTrk_Event_View
+*  ************************************************************************* */
+uint32_t MTrk_Event_View::get_size()
+{
+    // same count as MTrk_Event::get_size
+    uint32_t size = (uint32_t)Varlen::byte_count(dt) + length;
+
+    if ((status == STATUS_BYTE::SYSEX_F0) || (status == STATUS_BYTE::SYSEX_F7))
+    {
+        size += (uint32_t)Varlen::byte_count(length - 1);
+    }
+
+    return size;
+}
+
+/* ****************************************************************************
+*  MTrk_Event_Iterator
+*  ************************************************************************* */
+MTrk_Event_Iterator::MTrk_Event_Iterator(const uint8_t* body, uint32_t len):
+    p{body}, end{body + len}
+{
+    if (len == 0) // an empty MTrk chunk does not decode either
+    {
+        fail = true;
+        return;
+    }
+
+    next();
+}
+
+void MTrk_Event_Iterator::next()
+{
+    // same rules as MTrk_Chunk_Decoder::decode
+    event.data = nullptr;
+
+    if ((p == end) || fail)
+    {
+        return;
+    }
+
+    uint32_t payload_len = 0;
+    uint8_t parameter_count = 0;
+
+    if (!read_varlen(p, end, event.dt) || (p == end))
+    {
+        fail = true;
+        return;
+    }
+
+    const uint8_t* start = p;
+    STATUS_CLASS type = STATUS_TABLE[*p].type;
+
+    if (type == STATUS_CLASS::META)
+    {
+        p += 1;
+
+        if (p == end)
+        {
+            fail = true;
+            return;
+        }
+
+        p += 1;
+
+        if (!read_varlen(p, end, payload_len) || ((uint32_t)(end - p) < payload_len))
+        {
+            fail = true;
+            return;
+        }
+
+        p += payload_len;
+
+        event.status = STATUS_BYTE::META;
+        event.data = start + 1;
+        event.length = (uint32_t)(p - start);
+    }
+    else if (type == STATUS_CLASS::SYSEX)
+    {
+        p += 1;
+
+        if (!read_varlen(p, end, payload_len) || ((uint32_t)(end - p) < payload_len))
+        {
+            fail = true;
+            return;
+        }
+
+        for (uint32_t i = 0; i < payload_len; ++i)
+        {
+            if ((p[i] & 0b10000000) && (p[i] != STATUS_BYTE::SYSEX_F7))
+            {
+                fail = true;
+                return;
+            }
+        }
+
+        event.status = *start;
+        event.data = p;
+        event.length = payload_len + 1;
+        p += payload_len;
+    }
+    else
+    {
+        if (type != STATUS_CLASS::DATA) // setting new running_status
+        {
+            running_status = *p;
+            p += 1;
+        }
+
+        const Status_Info& info = STATUS_TABLE[running_status];
+        parameter_count = info.parameter_count;
+
+        if ((info.type != STATUS_CLASS::CHANNEL) || ((size_t)(end - p) < parameter_count))
+        {
+            fail = true;
+            return;
+        }
+
+        event.status = running_status;
+        event.data = p;
+        event.length = (uint32_t)parameter_count + 1;
+        p += parameter_count;
+    }
+}
+
+/* ****************************************************************************
+*  MTrk_View
+*  ************************************************************************* */
+size_t MTrk_View::size()
+{
+    size_t count = 0;
+
+    for (MTrk_Event_Iterator it = begin(); it != end(); ++it)
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+MIDI_Element_Decoder::STATUS MTrk_View::check()
+{
+    MIDI_Scanner scanner{};
+    size_t events = 0;
+    size_t bytes = 0;
+
+    return scanner.check_track(body, len, events, bytes);
+}
+
+/* ****************************************************************************
+*  MIDI_File_View
+*  ************************************************************************* */
+void MIDI_File_View::clear()
+{
+    hdr = MThd_View();
+    ordered_chunks.clear();
+    mtrk_chunks.clear();
+    unkn_chunks.clear();
+}
+
+MIDI_Element_Decoder::STATUS MIDI_File_View::index(const uint8_t* data, size_t len)
+{
+    MIDI_Scanner scanner{};
+
+    clear();
+
+    if (scanner.scan(data, len) == MIDI_Element_Decoder::STATUS::FAIL)
+    {
+        return MIDI_Element_Decoder::STATUS::FAIL;
+    }
+
+    hdr = MThd_View(MIDI_Chunk_View(CHUNK_HEADER::MTHD, scanner.get_chunk(0).body, scanner.get_chunk(0).len));
+
+    for (size_t i = 1; i < scanner.get_chunk_count(); ++i)
+    {
+        MIDI_Chunk_Span& span = scanner.get_chunk(i);
+        MIDI_Chunk_View chunk(span.header, span.body, span.len);
+
+        ordered_chunks.push_back(chunk);
+
+        if (span.header == CHUNK_HEADER::MTRK)
+        {
+            mtrk_chunks.emplace_back(chunk);
+        }
+        else
+        {
+            unkn_chunks.emplace_back(chunk);
+        }
+    }
+
+    return MIDI_Element_Decoder::STATUS::SUCCESS;
+}